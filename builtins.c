@@ -16,13 +16,15 @@
 
 #include "addon.h"
 #include "input.h"
+#include "interp.h"
 #include "jbwrap.h"
+#include "probe.h"
 #include "rlimit.h"
 #include "sigmsgs.h"
 
 static void b_break(char **), b_cd(char **), b_continue(char **), b_eval(char **),
   b_false(char **), b_flag(char **), b_exit(char **), b_newpgrp(char **),
-  b_return(char **), b_shift(char **), b_true(char **), b_umask(char **),
+  b_poll(char **), b_pwd(char **), b_return(char **), b_shift(char **), b_true(char **), b_umask(char **),
   b_wait(char **), b_whatis(char **);
 
 #if HAVE_SETRLIMIT
@@ -53,6 +55,8 @@ static struct {
 	{ b_limit,	"limit" },
 #endif
 	{ b_newpgrp,	"newpgrp" },
+	{ b_poll,	"poll" },
+	{ b_pwd,	"pwd" },
 	{ b_return,	"return" },
 	{ b_shift,	"shift" },
 	{ b_true,	"true" },
@@ -73,15 +77,41 @@ extern builtin_t *isbuiltin(char *s) {
     return NULL;
 }
 
+/* builtins which only write to their output, and leave the shell as it was */
+
+extern bool writeonly(builtin_t *b) {
+#if RC_ECHO
+    if (b == b_echo)
+	return TRUE;
+#endif
+    return b == b_pwd || b == b_true || b == b_false;
+}
+
 /* funcall() is the wrapper used to invoke shell functions. pushes $*, and "return" returns here. */
 
 extern void funcall(char **av) {
+	funcall_list(av, NULL);
+}
+
+/*
+   As funcall(), but $* is assigned from the argument list "args" (which
+   begins with the function name) rather than from av, so that it shares
+   storage with any variable the arguments came from.
+*/
+
+extern void funcall_list(char **av, List *args) {
 	Jbwrap j;
 	Estack e1, e2;
 	Edata jreturn, star;
-	if (sigsetjmp(j.j, 1))
+	if (sigsetjmp(j.j, 1)) {
+		RC_PROBE1(function__return, *av);
 		return;
-	starassign(*av, av+1, TRUE);
+	}
+	RC_PROBE1(function__entry, *av);
+	if (args != NULL)
+		varassign("*", args, TRUE);
+	else
+		starassign(*av, av+1, TRUE);
 	jreturn.jb = &j;
 	star.name = "*";
 	except(eReturn, jreturn, &e1);
@@ -90,6 +120,7 @@ extern void funcall(char **av) {
 	varrm("*", TRUE);
 	unexcept(eVarstack);
 	unexcept(eReturn);
+	RC_PROBE1(function__return, *av);
 }
 
 static void arg_count(char *name) {
@@ -123,6 +154,96 @@ static void b_echo(char **av) {
 }
 #endif
 
+/*
+   $cwd holds the logical name of the current directory. cd keeps it up
+   to date, so that pwd need not call getcwd(). pwd still checks that
+   $cwd names the directory "." is, since it may have been assigned or
+   inherited, or the directory changed behind rc's back (by a program
+   using librc, say). cwdset is the value we last gave $cwd.
+*/
+
+static char *cwdset = NULL;
+
+const Region builtinsglobals[] = {
+	REGION(cwdset),
+	{ NULL, 0 }
+};
+
+/* return getcwd() in nalloc space, or NULL */
+
+static char *physcwd(void) {
+    size_t size;
+    char *buf;
+    for (size = 256; ; size *= 2) {
+	buf = nalloc(size);
+	if (getcwd(buf, size) != NULL)
+	    return buf;
+	if (errno != ERANGE)
+	    return NULL;
+    }
+}
+
+/* do two names refer to the same directory? */
+
+static bool samedir(char *a, char *b) {
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 &&
+	sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+/*
+   Remove "." components and repeated slashes from an absolute path, and
+   cancel ".." against the preceding component. Returns TRUE if any ".."
+   was seen, since that is only right if the component was not a symlink.
+*/
+
+static bool cleanpath(char *path) {
+    char *from = path, *to = path;
+    bool dotdot = FALSE;
+    while (*from != '\0') {
+	while (*from == '/')
+	    from++;
+	if (from[0] == '.' && (from[1] == '/' || from[1] == '\0')) {
+	    from++;
+	} else if (from[0] == '.' && from[1] == '.' && (from[2] == '/' || from[2] == '\0')) {
+	    from += 2;
+	    dotdot = TRUE;
+	    while (to > path && *--to != '/')
+		;
+	} else if (*from != '\0') {
+	    *to++ = '/';
+	    while (*from != '/' && *from != '\0')
+		*to++ = *from++;
+	}
+    }
+    if (to == path)
+	*to++ = '/';
+    *to = '\0';
+    return dotdot;
+}
+
+/* set $cwd after a successful chdir(dir) */
+
+static void setcwd(char *dir) {
+    List *cwd = varlookup("cwd");
+    char *path = NULL;
+    if (*dir == '/')
+	path = nprint("%s", dir);
+    else if (cwd != NULL && cwdset != NULL && streq(cwd->w, cwdset))
+	path = nprint("%s/%s", cwd->w, dir);
+    if (path != NULL && cleanpath(path) && !samedir(path, "."))
+	path = NULL;
+    if (path == NULL && (path = physcwd()) == NULL) {
+	varrm("cwd", FALSE);
+	efree(cwdset);
+	cwdset = NULL;
+	return;
+    }
+    varassign("cwd", word(path, NULL), FALSE);
+    efree(cwdset);
+    cwdset = ecpy(path);
+}
+
 /* cd. traverse $cdpath if the directory given is not an absolute pathname */
 
 static void b_cd(char **av) {
@@ -140,8 +261,10 @@ static void b_cd(char **av) {
 	if (chdir(*av) < 0) {
 	    set(FALSE);
 	    uerror(*av);
-	} else
+	} else {
+	    setcwd(*av);
 	    set(TRUE);
+	}
     } else {
 	s = varlookup("cdpath");
 	if (s == NULL) {
@@ -163,6 +286,7 @@ static void b_cd(char **av) {
 		path = *av;
 	    }
 	    if (chdir(path) >= 0) {
+		setcwd(path);
 		set(TRUE);
 		if (interactive && *s->w != '\0' && !streq(s->w, "."))
 		    fprint(1, "%s\n", path);
@@ -175,6 +299,32 @@ static void b_cd(char **av) {
     }
 }
 
+/* pwd. print $cwd, checking it against "." only if cd did not set it */
+
+static void b_pwd(char **av) {
+    List *cwd;
+    if (av[1] != NULL) {
+	arg_count("pwd");
+	return;
+    }
+    cwd = varlookup("cwd");
+    if (cwd == NULL || *cwd->w != '/' || !samedir(cwd->w, ".")) {
+	efree(cwdset);
+	cwdset = NULL; /* so that setcwd() does not build on $cwd */
+	setcwd(".");
+	if ((cwd = varlookup("cwd")) == NULL) {
+	    uerror("pwd");
+	    set(FALSE);
+	    return;
+	}
+    } else if (cwdset == NULL || !streq(cwd->w, cwdset)) {
+	efree(cwdset);
+	cwdset = ecpy(cwd->w);
+    }
+    fprint(1, "%s\n", cwd->w);
+    set(TRUE);
+}
+
 static void b_umask(char **av) {
     int i;
     if (*++av == NULL) {
@@ -303,7 +453,6 @@ static void b_continue(char **av) {
 
 static void b_shift(char **av) {
 	int shift = (av[1] == NULL ? 1 : a2u(av[1]));
-	List *s, *dollarzero;
 	if (av[1] != NULL && av[2] != NULL) {
 		arg_count("shift");
 		return;
@@ -312,19 +461,11 @@ static void b_shift(char **av) {
 		badnum(av[1]);
 		return;
 	}
-	s = varlookup("*")->n;
-	dollarzero = varlookup("0");
-	while (s != NULL && shift != 0) {
-		s = s->n;
-		--shift;
-	}
-	if (s == NULL && shift != 0) {
+	if (!starshift(shift)) {
 		fprint(2, "rc: cannot shift\n");
 		set(FALSE);
-	} else {
-		varassign("*", append(dollarzero, s), FALSE);
+	} else
 		set(TRUE);
-	}
 }
 
 /* dud function */
@@ -352,6 +493,91 @@ static void b_wait(char **av) {
 		setwaitstatus(av, "wait");
 }
 
+/* a timeout in seconds, perhaps with a fraction, as milliseconds; -1 if bad */
+
+static long a2ms(char *s) {
+    long ms = 0, unit = 1000;
+    bool digits = FALSE;
+    for (; *s >= '0' && *s <= '9'; s++, digits = TRUE)
+	ms = ms * 10 + (*s - '0');
+    ms *= 1000;
+    if (*s == '.')
+	for (s++; *s >= '0' && *s <= '9'; s++, digits = TRUE)
+	    ms += (*s - '0') * (unit /= 10);
+    return (*s == '\0' && digits) ? ms : -1;
+}
+
+/*
+   poll [-t timeout] [-r fd] [-w fd] [pid ...] waits until an fd can be
+   read or written, a process exits or the timeout expires, and prints
+   what is ready: rN or wN for an fd, and the pid of a process.
+*/
+
+static void b_poll(char **av) {
+    int ac, c, i, n, nfds = 0, npids = 0, *fds;
+    long ms = -1;
+    bool *out, *ready;
+    pid_t *pids;
+    struct stat s;
+    List *r = NULL;
+
+    for (rc_optind = ac = 0; av[ac] != NULL; ac++)
+	; /* count the arguments for getopt */
+    fds = nalloc(ac * sizeof *fds);
+    out = nalloc(ac * sizeof *out);
+    pids = nalloc(ac * sizeof *pids);
+    ready = nalloc(ac * sizeof *ready);
+    while ((c = rc_getopt(ac, av, "t:r:w:")) != -1)
+	switch (c) {
+	default:
+	    set(FALSE);
+	    return;
+	case 't':
+	    if ((ms = a2ms(rc_optarg)) < 0) {
+		fprint(2, RC "`%s' is a bad timeout\n", rc_optarg);
+		set(FALSE);
+		return;
+	    }
+	    break;
+	case 'r': case 'w':
+	    if ((fds[nfds] = a2u(rc_optarg)) < 0) {
+		fprint(2, RC "`%s' is a bad number\n", rc_optarg);
+		set(FALSE);
+		return;
+	    }
+	    if (fstat(fds[nfds], &s) < 0) {
+		uerror(rc_optarg);
+		set(FALSE);
+		return;
+	    }
+	    out[nfds++] = (c == 'w');
+	    break;
+	}
+    for (av += rc_optind; *av != NULL; av++)
+	if ((pids[npids++] = a2u(*av)) < 0) {
+	    fprint(2, RC "`%s' is a bad number\n", *av);
+	    set(FALSE);
+	    return;
+	}
+    if ((n = rc_poll(fds, out, nfds, pids, npids, ms, ready)) < 0) {
+	if (errno != EINTR)
+	    uerror("poll");
+	set(FALSE);
+	sigchk();
+	return;
+    }
+    for (i = nfds + npids; i-- > 0;)
+	if (ready[i]) {
+	    List *q = word(i < nfds ? nprint("%c%d", out[i] ? 'w' : 'r', fds[i])
+			: nprint("%d", pids[i - nfds]), NULL);
+	    q->n = r;
+	    r = q;
+	}
+    if (r != NULL)
+	fprint(1, "%L\n", r, " ");
+    set(n > 0);
+}
+
 /*
    whatis without arguments prints all variables and functions. Otherwise, check to see if a name
    is defined as a variable, function or pathname.
@@ -56,9 +56,24 @@
 /* Define to 1 if you have the `lstat' function. */
 #define HAVE_LSTAT 1
 
+/* Define to 1 if you have the `memfd_create' function. */
+#ifdef __linux__
+#define HAVE_MEMFD_CREATE 1
+#endif
+
 /* Define to 1 if you have the `mkfifo' function. */
 #define HAVE_MKFIFO 1
 
+/* Define to 1 if you have the `pidfd_open' system call. */
+#ifdef __linux__
+#define HAVE_PIDFD_OPEN 1
+#endif
+
+/* Define to 1 if you have the `ppoll' function. */
+#ifdef __linux__
+#define HAVE_PPOLL 1
+#endif
+
 /* Define to 1 if you have the `setpgrp' function. */
 #define HAVE_SETPGRP 1
 
@@ -92,6 +107,9 @@
 /* Define to 1 if you have the <sys/types.h> header file. */
 #define HAVE_SYS_TYPES_H 1
 
+/* Define to 1 if you have the <sys/sdt.h> header file (for USDT probes). */
+/* #undef HAVE_SYS_SDT_H */
+
 /* Define to 1 if you have <sys/wait.h> that is POSIX.1 compatible. */
 #define HAVE_SYS_WAIT_H 1
 
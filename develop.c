@@ -79,6 +79,9 @@ void dump(Node *n, int indent) {
 	case nBackq:
 		dump_1("nBackq", n, indent);
 		break;
+	case nFuture:
+		dump_1("nFuture", n, indent);
+		break;
 	case nBang:
 		dump_1("nBang", n, indent);
 		break;
@@ -253,6 +256,9 @@ void tree_dump(Node *f) {
 		fmtprint(f, "{%X}", n->u[1].p);
 		break;
 	}
+	case nFuture:
+		fmtprint(f, "`&{%X}", n->u[1].p);
+		break;
 	case nCbody:
 	case nBody: {
 		Node *n0 = n->u[0].p;
@@ -4,6 +4,7 @@
 #include <signal.h>
 
 #include "input.h"
+#include "interp.h"
 #include "jbwrap.h"
 
 /*
@@ -15,6 +16,11 @@ bool nl_on_intr = TRUE;
 
 static Estack *estack;
 
+const Region exceptglobals[] = {
+	REGION(nl_on_intr), REGION(estack),
+	{ NULL, 0 }
+};
+
 /* add an exception to the input stack. */
 
 extern void except(ecodes e, Edata data, Estack *ex) {
@@ -45,6 +51,9 @@ extern void unexcept(ecodes e) {
 	case eFd:
 		close(estack->data.fd);
 		break;
+	case eValue:
+		valfree(estack->data.val);
+		break;
 	}
 	estack = estack->prev;
 }
@@ -64,7 +73,7 @@ extern void unexcept(ecodes e) {
 
 extern void rc_raise(ecodes e) {
 	if (e == eError && rc_pid != getpid())
-		exit(1); /* child processes exit on an error/signal */
+		childexit(1); /* child processes exit on an error/signal */
 	for (; estack != NULL; estack = estack->prev)
 		if (estack->e != e) {
 			if (e == eBreak && (estack->e != eArena && estack->e != eVarstack && estack->e != eContinue))
@@ -88,6 +97,9 @@ extern void rc_raise(ecodes e) {
 			case eFd:
 				close(estack->data.fd);
 				break;
+			case eValue:
+				valfree(estack->data.val);
+				break;
 			}
 		} else {
 			if (e == eError && !estack->interactive) {
@@ -107,6 +119,17 @@ extern bool outstanding_cmdarg() {
 	return estack->e == eFifo || estack->e == eFd;
 }
 
+/* the number of function calls and dot scripts in progress, for tracing */
+
+extern int fndepth() {
+	Estack *e;
+	int n = 0;
+	for (e = estack; e != NULL; e = e->prev)
+		if (e->e == eVarstack && streq(e->data.name, "*"))
+			n++;
+	return n;
+}
+
 extern void pop_cmdarg(bool remove) {
 	for (; estack != NULL; estack = estack->prev)
 		switch (estack->e) {
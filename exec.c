@@ -7,6 +7,7 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "probe.h"
 #include "wait.h"
 
 /*
@@ -20,9 +21,9 @@ extern void exec(List *s, bool parent) {
 	pid_t pid;
 	builtin_t *b;
 	char *path = NULL;
-	bool didfork, returning, saw_exec, saw_builtin;
+	bool didfork, returning, saw_exec, saw_builtin, prefetched = FALSE;
 	struct termios t;
-	av = list2array(s, dashex);
+	av = list2array(s, dashex); /* s is kept in step with av, for funcall_list() */
 	saw_builtin = saw_exec = FALSE;
 	do {
 		if (*av == NULL	|| isabsolute(*av))
@@ -40,15 +41,19 @@ extern void exec(List *s, bool parent) {
 
 		if (b == b_exec) {
 			av++;
+			s = s->n;
 			saw_exec = TRUE;
 			parent = FALSE;
 		} else if (b == b_builtin) {
 			av++;
+			s = s->n;
 			saw_builtin = TRUE;
 		}
 	} while (b == b_exec || b == b_builtin);
+	if (saw_exec && embedded && getpid() == rc_pid)
+		rc_error("exec is not available in librc");
 	if (*av == NULL && saw_exec) { /* do redirs and return on a null exec */
-		doredirs();
+		doredirs(FALSE);
 		return;
 	}
 	/* force an exit on exec with any rc_error, but not for null commands as above */
@@ -64,6 +69,7 @@ extern void exec(List *s, bool parent) {
 			rc_exit(1);
 		}
 		ev = makeenv(); /* environment only needs to be built for execve() */
+		dropexecs();
 	}
 	/*
 	   If parent & the redirq is nonnull, builtin or not it has to fork.
@@ -71,6 +77,8 @@ extern void exec(List *s, bool parent) {
 	   must fork no matter what.
 	 */
 	if ((parent && (b == NULL || redirq != NULL)) || outstanding_cmdarg()) {
+		if (parent && redirq != NULL)
+			prefetched = prefetchredirs();
 		if (interactive)
 			tcgetattr(0, &t);
 		pid = rc_fork();
@@ -89,16 +97,21 @@ extern void exec(List *s, bool parent) {
 		if (!returning)
 			setsigdefaults(FALSE);
 		pop_cmdarg(FALSE);
-		doredirs();
+		doredirs(prefetched);
 
 		/* null commands performed for redirections */
 		if (*av == NULL || b != NULL) {
-			if (b != NULL)
+			if (b == funcall)
+				funcall_list(av, s);
+			else if (b != NULL)
 				(*b)(av);
 			if (returning)
 				return;
 			rc_exit(getstatus());
 		}
+		traceflush();
+		giveslots(); /* if rc itself is replaced */
+		RC_PROBE1(exec, path);
 		rc_execve(path, (char * const *) av, (char * const *) ev);
 
 #ifdef DEFAULTINTERP
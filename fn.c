@@ -9,6 +9,7 @@
 #include <errno.h>
 
 #include "input.h"
+#include "interp.h"
 #include "sigmsgs.h"
 
 static void fn_handler(int), dud_handler(int);
@@ -19,6 +20,12 @@ static void (*def_sigint)(int) = SIG_DFL;
 static void (*def_sigquit)(int) = SIG_DFL;
 static void (*def_sigterm)(int) = SIG_DFL;
 
+const Region fnglobals[] = {
+	REGION(runexit), REGION(handlers),
+	REGION(def_sigint), REGION(def_sigquit), REGION(def_sigterm),
+	{ NULL, 0 }
+};
+
 /*
    Set signals to default values for rc. This means that interactive
    shells ignore SIGTERM, etc.
@@ -28,6 +35,8 @@ extern void inithandler() {
 	int i;
 	null.type = nBody;
 	null.u[0].p = null.u[1].p = NULL;
+	if (embedded)
+		return; /* the signals belong to the program rc is linked into */
 	for (i = 1; i < NUMOFSIGNALS; i++)
 		if (i != SIGCHLD && sighandlers[i] == SIG_IGN)
 			fnassign(signals[i].name, NULL); /* ignore incoming ignored signals */
@@ -50,55 +59,41 @@ extern void inithandler() {
 /* only run this in a child process! resets signals to their default values */
 
 extern void setsigdefaults(bool sysvbackground) {
-	int i;
-	/*
-	   General housekeeping: setsigdefaults happens after fork(),
-	   so it's a convenient place to clean up open file descriptors.
-	   (history file, scripts, etc.)
-	*/
-	closefds();
+	int i, n, sigs[NUMOFSIGNALS];
 	/*
+	   Scripts being read are close-on-exec (see pushfd()), so
+	   there are no file descriptors to tidy up here.
+
 	   Restore signals to SIG_DFL, paying close attention to
 	   a few quirks: SIGINT, SIGQUIT and are treated specially
 	   depending on whether we are doing v7-style backgrounding
 	   or not; the default action for SIGINT, SIGQUIT and SIGTERM
 	   must be set to the appropriate action; finally, care must
 	   be taken not to set to SIG_DFL any signals which are being
-	   ignored.
+	   ignored. Only the signals rc catches need a system call, and
+	   signal.c keeps a list of those.
 	*/
-	for (i = 1; i < NUMOFSIGNALS; i++)
-		if (sighandlers[i] != SIG_IGN) {
+	if (sighandlers[SIGINT] != SIG_IGN) {
+		def_sigint = sysvbackground ? SIG_IGN : SIG_DFL;
+		if (sysvbackground)
+			fnassign("sigint", NULL); /* ignore */
+	}
+	if (sighandlers[SIGQUIT] != SIG_IGN) {
+		def_sigquit = sysvbackground ? SIG_IGN : SIG_DFL;
+		if (sysvbackground)
+			fnassign("sigquit", NULL); /* ignore */
+	}
+	if (sighandlers[SIGTERM] != SIG_IGN)
+		def_sigterm = SIG_DFL;
+	n = hookedsignals(sigs);
+	while (n-- > 0) {
+		i = sigs[n];
+		if (sighandlers[i] != SIG_IGN && sighandlers[i] != SIG_DFL) {
 			handlers[i] = NULL;
-			switch (i) {
-			case SIGINT:
-				if (sysvbackground) {
-					def_sigint = SIG_IGN;
-					fnassign("sigint", NULL); /* ignore */
-				} else {
-					def_sigint = SIG_DFL;
-					goto sigcommon;
-				}
-				break;
-			case SIGQUIT:
-				if (sysvbackground) {
-					def_sigquit = SIG_IGN;
-					fnassign("sigquit", NULL); /* ignore */
-				} else {
-					def_sigquit = SIG_DFL;
-					goto sigcommon;
-				}
-				break;
-			case SIGTERM:
-				def_sigterm = SIG_DFL;
-				/* FALLTHROUGH */
-			sigcommon:
-			default:
-				if (sighandlers[i] != SIG_DFL) {
-					rc_signal(i, SIG_DFL);
-					delete_fn(signals[i].name);
-				}
-			}
+			rc_signal(i, SIG_DFL);
+			delete_fn(signals[i].name);
 		}
+	}
 	delete_fn("sigexit");
 	runexit = FALSE; /* No sigexit on subshells */
 }
@@ -114,6 +109,25 @@ extern void rc_exit(int stat) {
 		funcall(sig);
 		stat = getstatus();
 	}
+	if (embedded && getpid() == rc_pid) { /* end the librc_run(), not the program */
+		if (stat != getstatus())
+			setstatus(-1, (stat & 0xff) << 8);
+		rc_raise(eError);
+	}
+	giveslots();
+	childexit(stat);
+}
+
+/*
+   A child of librc leaves with _exit(), so as not to run the program's
+   atexit() handlers or flush its stdio buffers a second time.
+*/
+
+extern void childexit(int stat) {
+	if (embedded) {
+		traceflush();
+		_exit(stat);
+	}
 	exit(stat);
 }
 
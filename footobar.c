@@ -6,6 +6,14 @@
 #include "rc.h"
 
 #include "input.h"
+#include "interp.h"
+
+static bool inlist; /* Tconv() is inside a list */
+
+const Region footobarglobals[] = {
+	REGION(inlist),
+	{ NULL, 0 }
+};
 
 /* protect an exported name from brain-dead shells */
 
@@ -80,7 +88,6 @@ static bool Tconv(Format *f, int ignore) {
 				"%#S" : "%S", n->u[0].s);
 		break;
 	case nLappend: {
-		static bool inlist;
 		if (!inlist) {
 			inlist = TRUE;
 			fmtprint(f, "(%T %T)", n->u[0].p, n->u[1].p);
@@ -121,6 +128,7 @@ static bool Tconv(Format *f, int ignore) {
 		fmtprint(f, "{%T}", n->u[1].p);
 		break;
 	}
+	case nFuture:	fmtprint(f, "`&{%T}", n->u[1].p);			break;
 	case nCbody:
 	case nBody: {
 		Node *n0 = n->u[0].p;
@@ -180,7 +188,7 @@ extern char **list2array(List *s, bool print) {
 	char **argv, **av;
 
 	if (print)
-		fprint(2, "%L\n", s, " ");
+		tracecmd(s);
 	/*
 	   Allocate 3 extra spots (2 for the fake execve & 1 for defaulting to
 	   sh) and hide these from exec().
@@ -229,13 +237,15 @@ extern char *get_name(char *s) {
 		}
 }
 
+static const char envspecial[] = { ENV_SEP, ENV_ESC, '\0' };
+
 /* interpret a variable from environment.  ^A separates list elements;
    ^B escapes a literal ^A or ^B.  For minimal surprise, ^B followed
    by anything other than ^A or ^B is preserved. */
 
 extern List *parse_var(char *extdef) {
 	char *begin, *end, *from, *to;
-	int len;
+	size_t n, nesc;
 	List *first, *last, *new;
 
 	first = last = NULL;
@@ -243,33 +253,31 @@ extern List *parse_var(char *extdef) {
 	assert(begin); /* guaranteed by initenv() */
 	while (*begin) {
 		++begin;
-		end = begin;
-		len = 0;
-		while (*end != ENV_SEP && *end != '\0') {
-			if (*end == ENV_ESC) {
-				++end;
-				if (*end != ENV_SEP && *end != ENV_ESC) --end;
+		nesc = 0;
+		for (end = begin; *(end += strcspn(end, envspecial)) == ENV_ESC; end++)
+			if (end[1] == ENV_SEP || end[1] == ENV_ESC) {
+				end++;
+				nesc++;
 			}
-			++end; ++len;
-		}
 		new = enew(List);
 		if (last)
 			last->n = new;
 		else
 			first = new;
 		last = new;
-		new->w = ealloc(len + 1);
+		new->w = ealloc(end - begin - nesc + 1);
 		new->m = NULL;
 		new->n = NULL;
 		to = new->w;
-		for (from = begin; from < end; ++from) {
-			if (*from == ENV_ESC) {
+		for (from = begin; from < end; ++from) { /* copy the spans between escapes */
+			n = strcspn(from, envspecial);
+			memcpy(to, from, n);
+			to += n;
+			if ((from += n) == end)
+				break;
+			if (from[1] == ENV_SEP || from[1] == ENV_ESC)
 				++from;
-				if (*from != ENV_SEP && *from != ENV_ESC)
-					--from;
-			}
-			*to = *from;
-			++to;
+			*to++ = *from;
 		}
 		*to = '\0';
 		begin = end;
@@ -277,6 +285,40 @@ extern List *parse_var(char *extdef) {
 	return first;
 }
 
+/* the inverse of parse_var(): name=value, made in one piece of the right size */
+
+extern char *unparse_var(char *name, List *s) {
+	char *prefix, *r, *t, *w;
+	size_t n, size;
+	List *l;
+
+	prefix = nprint("%F=", name);
+	size = strlen(prefix) + 1;
+	for (l = s; l != NULL; l = l->n) {
+		for (w = l->w; *(w += strcspn(w, envspecial)) != '\0'; w++)
+			size++;
+		size += w - l->w + (l->n != NULL);
+	}
+	r = ealloc(size);
+	strcpy(r, prefix);
+	t = r + strlen(prefix);
+	for (l = s; l != NULL; l = l->n) {
+		for (w = l->w;; w++) {
+			n = strcspn(w, envspecial);
+			memcpy(t, w, n);
+			t += n;
+			if (*(w += n) == '\0')
+				break;
+			*t++ = ENV_ESC;
+			*t++ = *w;
+		}
+		if (l->n != NULL)
+			*t++ = ENV_SEP;
+	}
+	*t = '\0';
+	return r;
+}
+
 /* get an environment entry for a function and have rc parse it. */
 
 #define PREFIX "fn x"
@@ -324,25 +366,6 @@ static bool Lconv(Format *f, int ignore) {
 	return FALSE;
 }
 
-/* %W -- print a list for exporting */
-static bool Wconv(Format *f, int ignore) {
-	List *l, *n;
-
-	l = va_arg(f->args, List *);
-	for (; l != NULL; l = n) {
-		char c, *s;
-
-		for (s = l->w; (c = *s) != '\0'; ++s) {
-			if (c == ENV_SEP || c == ENV_ESC)
-				fmtputc(f, ENV_ESC);
-			fmtputc(f, c);
-		}
-		n = l->n;
-		if (n != NULL) fmtputc(f, ENV_SEP);
-	}
-	return FALSE;
-}
-
 #define	ISMETA(c)	(c == '*' || c == '?' || c == '[')
 
 static bool Sconv(Format *f, int ignore) {
@@ -379,7 +402,6 @@ void initprint(void) {
 	fmtinstall('S', Sconv);
 	fmtinstall('T', Tconv);
 	fmtinstall('D', Dconv);
-	fmtinstall('W', Wconv);
 #if PROTECT_ENV
 	fmtinstall('F', Fconv);
 #else
@@ -0,0 +1,148 @@
+/* future.c: x=`&{cmd} starts cmd at once, and $x waits for its output */
+
+#include "rc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+#include "interp.h"
+#include "wait.h"
+
+/*
+   The command's output goes to an anonymous file, so it never blocks,
+   however long the shell takes to look at it. The command also holds
+   the write end of a pipe (closed on exec), whose reader sees end of
+   file once the command is over; this works in a subshell too, which
+   cannot wait for its parent's children. Until then the variable is
+   simply not set, so it is not exported, and assigning to it or
+   deleting it abandons the command.
+*/
+
+typedef struct Future Future;
+
+struct Future {
+	char *name;
+	Value *ifs;
+	pid_t pid, owner;	/* owner may wait for pid */
+	int out, done;
+	Future *n;
+};
+
+static Future *futures;
+
+const Region futureglobals[] = {
+	REGION(futures),
+	{ NULL, 0 }
+};
+
+/* move fd out of the way of the user's fds, closed on exec */
+
+extern int highfd(int fd) {
+	int hi = fcntl(fd, F_DUPFD, 10);
+	close(fd);
+	if (hi >= 0)
+		fcntl(hi, F_SETFD, FD_CLOEXEC);
+	return hi;
+}
+
+static Future **find(char *name) {
+	Future **f;
+	for (f = &futures; *f != NULL; f = &(*f)->n)
+		if (streq((*f)->name, name))
+			break;
+	return f;
+}
+
+static void forget(Future **fp) {
+	Future *f = *fp;
+	*fp = f->n;
+	if (f->owner == getpid())
+		ownchild(f->pid, FALSE);
+	close(f->out);
+	close(f->done);
+	efree(f->name);
+	valfree(f->ifs);
+	efree(f);
+}
+
+/* an assignment to (or deletion of) name abandons its command */
+
+extern void dropfuture(char *name) {
+	Future **f;
+	if (futures != NULL && *(f = find(name)) != NULL)
+		forget(f);
+}
+
+/* abandon every command; their children are left to be reaped as usual */
+
+extern void dropfutures() {
+	while (futures != NULL)
+		forget(&futures);
+}
+
+extern void future(List *var, Node *n) {
+	Future *f;
+	int out, p[2];
+	pid_t pid;
+
+	checkvarname(var);
+	varrm(var->w, FALSE); /* also drops an earlier future */
+	if ((out = rc_tmpfd()) < 0) {
+		uerror("tmpfile");
+		rc_error(NULL);
+	}
+	if (pipe(p) < 0) {
+		close(out);
+		uerror("pipe");
+		rc_error(NULL);
+	}
+	if ((pid = rc_forkjob()) == 0) {
+		setsigdefaults(FALSE);
+		mvfd(out, 1);
+		close(p[0]);
+		fcntl(p[1], F_SETFD, FD_CLOEXEC);
+		redirq = NULL;
+		walk(n->u[1].p, FALSE);
+		childexit(getstatus());
+	}
+	close(p[1]);
+	ownchild(pid, TRUE); /* until await() or an abandonment */
+	f = enew(Future);
+	f->name = ecpy(var->w);
+	f->ifs = listval(glom(n->u[0].p));
+	f->pid = pid;
+	f->owner = getpid();
+	f->out = highfd(out);
+	f->done = highfd(p[0]);
+	f->n = futures;
+	futures = f;
+}
+
+/* if name is waiting for a command, wait for it and assign its output */
+
+extern void await(char *name) {
+	Future **fp, *f;
+	List *val;
+	pid_t pid;
+	char c;
+	int n, sp;
+
+	if (futures == NULL || *(fp = find(name)) == NULL)
+		return;
+	f = *fp;
+	while ((n = rc_read(f->done, &c, 1)) != 0)
+		if (n < 0) {
+			if (errno != EINTR)
+				break;
+			sigchk(); /* the future remains for next time */
+		}
+	lseek(f->out, 0, SEEK_SET);
+	val = bqinput(f->ifs == NULL ? NULL : f->ifs->def, f->out);
+	pid = f->owner == getpid() ? f->pid : -1;
+	forget(fp);
+	if (pid != -1) {
+		rc_wait4(pid, &sp, TRUE);
+		varassign("bqstatus", word(strstatus(sp), NULL), FALSE);
+	}
+	assign(word(name, NULL), val, FALSE);
+}
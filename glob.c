@@ -1,8 +1,12 @@
 /* glob.c: rc's (ugly) globber. This code is not elegant, but it works */
 
 #include "rc.h"
+#include "interp.h"
+#include "probe.h"
 #include "stat.h"
 
+#include <time.h>
+
 /* Lifted from autoconf documentation.*/
 #if HAVE_DIRENT_H
 # include <dirent.h>
@@ -21,11 +25,47 @@
 # endif
 #endif
 
+typedef struct Dircache Dircache;
+
 static List *dmatch(char *, char *, char *);
 static List *doglob(char *, char *);
+static List *excludes(void);
+static bool want(char *, char *, char *);
+static Dircache *dirlist(char *);
+static void dirtrim(int);
 static List *lglob(List *, char *, char *, size_t);
 static List *sort(List *);
 
+static List *exclude; /* patterns from $globexclude, for dmatch() */
+
+/*
+   With $globcache set to n, the listings of up to n directories are
+   kept between commands, and reused while the directory's mtime and
+   ctime are unchanged. A listing read in the same second as the last
+   change to the directory may have missed a second change within that
+   second, so such a listing is not trusted.
+*/
+
+struct Dircache {
+	dev_t dev;
+	ino_t ino;
+	time_t mtime, ctime, read;
+	unsigned long used;	/* for least-recently-used eviction */
+	int nnames;
+	char *names;		/* nnames NUL-terminated names, end to end */
+};
+
+static Dircache *dircache;
+static int ncache, cachemax;
+static unsigned long cacheclock, cachehits, cachemisses;
+
+const Region globglobals[] = {
+	REGION(dircache), REGION(ncache), REGION(cachemax),
+	REGION(cacheclock), REGION(cachehits), REGION(cachemisses),
+	REGION(exclude),
+	{ NULL, 0 }
+};
+
 /*
    Matches a list of words s against a list of patterns p. Returns true iff
    a pattern in p matches a word in s. () matches (), but otherwise null
@@ -58,11 +98,17 @@ extern bool lmatch(List *s, List *p) {
 extern List *glob(List *s) {
 	List *top, *r;
 	bool meta;
-	for (r = s, meta = FALSE; r != NULL; r = r->n)
+	for (r = s, meta = FALSE; r != NULL && valfind(r) == NULL; r = r->n) /* stored values have no meta */
 		if (r->m != NULL)
 			meta = TRUE;
 	if (!meta)
 		return s; /* don't copy lists with no metacharacters in them */
+	RC_PROBE1(glob__start, s->w);
+	exclude = excludes();
+	if ((cachemax = (r = varlookup("globcache")) == NULL ? 0 : a2u(r->w)) < 0)
+		cachemax = 0;
+	if (ncache > cachemax) /* $globcache was reduced */
+		dirtrim(cachemax);
 	for (top = r = NULL; s != NULL; s = s->n) {
 		if (s->m == NULL) { /* no metacharacters; just tack on to the return list */
 			if (top == NULL)
@@ -80,17 +126,139 @@ extern List *glob(List *s) {
 		}
 	}
 	r->n = NULL;
+	RC_PROBE1(glob__done, top->w);
 	return top;
 }
 
+/*
+   Returns $globexclude as a list of patterns. Since the value of a
+   variable carries no quoting, every metacharacter in it is live.
+*/
+
+static List *excludes() {
+	List *e, *r, *top, **end = &top;
+	char *w, *m;
+	for (e = varlookup("globexclude"); e != NULL; e = e->n) {
+		r = *end = nnew(List);
+		r->w = e->w;
+		r->m = m = nalloc(strlen(e->w) + 1);
+		for (w = e->w; *w != '\0'; w++)
+			*m++ = (*w == '?' || *w == '[' || *w == '*');
+		end = &r->n;
+	}
+	*end = NULL;
+	return top;
+}
+
+/* Should a name read from a directory be matched by pattern p? */
+
+static bool want(char *name, char *p, char *m) {
+	List *x;
+	if (name[0] == '.' && (
+		p[0] != '.' || /* hidden files need to be matched explicitly */
+		name[1] == '\0' || /* never include . */
+		(name[1] == '.' && name[2] == '\0') /* nor .. */
+		))
+		return FALSE;
+	if (!match(p, m, name))
+		return FALSE;
+	for (x = exclude; x != NULL; x = x->n)
+		if (match(x->w, x->m, name))
+			return FALSE; /* excluded before it costs anything */
+	return TRUE;
+}
+
+static void dirfree(Dircache *c) {
+	efree(c->names);
+	*c = dircache[--ncache];
+}
+
+/* evict the least recently used listings until at most n remain */
+
+static void dirtrim(int n) {
+	Dircache *c, *lru;
+	while (ncache > n) {
+		for (c = lru = dircache; c < dircache + ncache; c++)
+			if (c->used < lru->used)
+				lru = c;
+		dirfree(lru);
+	}
+}
+
+/* empty the cache, for freeinterp() */
+
+extern void forgetdirs() {
+	dirtrim(0);
+	efree(dircache);
+	dircache = NULL;
+}
+
+/* Return the (possibly cached) listing of directory d, or NULL */
+
+static Dircache *dirlist(char *d) {
+	struct stat s;
+	struct dirent *dp;
+	DIR *dirp;
+	Dircache *c;
+	size_t len, used, size;
+	time_t now;
+
+	if (stat(d, &s) < 0 || (s.st_mode & S_IFMT) != S_IFDIR)
+		return NULL;
+	for (c = dircache; c < dircache + ncache; c++)
+		if (c->dev == s.st_dev && c->ino == s.st_ino) {
+			if (c->mtime == s.st_mtime && c->ctime == s.st_ctime &&
+			    c->mtime < c->read && c->ctime < c->read) {
+				cachehits++;
+				c->used = ++cacheclock;
+				return c;
+			}
+			dirfree(c);
+			break;
+		}
+	cachemisses++;
+	now = time(NULL);
+	if ((dirp = opendir(d)) == NULL)
+		return NULL;
+	dirtrim(cachemax - 1);
+	dircache = erealloc(dircache, (ncache + 1) * sizeof *dircache);
+	c = &dircache[ncache++];
+	c->dev = s.st_dev;
+	c->ino = s.st_ino;
+	c->mtime = s.st_mtime;
+	c->ctime = s.st_ctime;
+	c->read = now;
+	c->used = ++cacheclock;
+	c->nnames = 0;
+	c->names = ealloc(size = 1024);
+	for (used = 0; (dp = readdir(dirp)) != NULL; used += len, c->nnames++) {
+		len = NAMLEN(dp) + 1;
+		if (used + len > size)
+			c->names = erealloc(c->names, size = 2 * (used + len));
+		memcpy(c->names + used, dp->d_name, len);
+	}
+	closedir(dirp);
+	return c;
+}
+
+/* The statistics of the glob cache, for $rcstats */
+
+extern void globstats(unsigned long *hits, unsigned long *misses, int *dirs) {
+	*hits = cachehits;
+	*misses = cachemisses;
+	*dirs = ncache;
+}
+
 /* Matches a pattern p against the contents of directory d */
 
 static List *dmatch(char *d, char *p, char *m) {
 	bool matched;
 	List *top, *r;
-	static DIR *dirp;
-	static struct dirent *dp;
-	static struct stat s;
+	DIR *dirp;
+	struct dirent *dp;
+	struct stat s;
+	Dircache *c;
+	char *name;
 	int i;
 
 	/*
@@ -118,6 +286,24 @@ static List *dmatch(char *d, char *p, char *m) {
 
 	top = r = NULL;
 	if (*d == '\0') d = "/";
+	if (cachemax > 0) {
+		if ((c = dirlist(d)) == NULL)
+			return NULL;
+		for (i = 0, name = c->names; i < c->nnames; i++, name += strlen(name) + 1)
+			if (want(name, p, m)) {
+				matched = TRUE;
+				if (top == NULL)
+					top = r = nnew(List);
+				else
+					r = r->n = nnew(List);
+				r->w = ncpy(name);
+				r->m = NULL;
+			}
+		if (!matched)
+			return NULL;
+		r->n = NULL;
+		return top;
+	}
 	if ((dirp = opendir(d)) == NULL)
 		return NULL;
 	/* opendir succeeds on regular files on some systems, so the stat() call is necessary (sigh) */
@@ -126,11 +312,7 @@ static List *dmatch(char *d, char *p, char *m) {
 		return NULL;
 	}
 	while ((dp = readdir(dirp)) != NULL)
-		if (!(dp->d_name[0] == '.' && (
-			p[0] != '.' || /* hidden files need to be matched explicitly */
-			dp->d_name[1] == '\0' || /* never include . */
-			(dp->d_name[1] == '.' && dp->d_name[2] == '\0') /* nor .. */
-			)) && match(p, m, dp->d_name)) {
+		if (want(dp->d_name, p, m)) {
 			matched = TRUE;
 			if (top == NULL)
 				top = r = nnew(List);
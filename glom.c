@@ -1,20 +1,30 @@
 /* glom.c: builds an argument list out of words, variables, etc. */
 
 #include "rc.h"
+#include "interp.h"
+#include "probe.h"
 #include "wait.h"
 
 #include <sys/stat.h>
 #include <signal.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
 
 static List *backq(Node *, Node *);
-static List *bqinput(List *, int);
-static List *count(List *);
+
+static List *count(int);
+static List *glomargs(Node *, bool);
 static List *mkcmdarg(Node *);
 
 Rq *redirq = NULL;
+static Rq *redirtail; /* last element of redirq, valid iff redirq != NULL */
+
+const Region glomglobals[] = {
+	REGION(redirq), REGION(redirtail),
+	{ NULL, 0 }
+};
 
 extern List *word(char *w, char *m) {
 	List *s = NULL;
@@ -192,16 +202,17 @@ extern List *flatten(List *s) {
 	return r;
 }
 
-static List *count(List *l) {
+static List *count(int nel) {
 	List *s = nnew(List);
-	s->w = nprint("%d", listnel(l));
+	s->w = numword(nel);
 	s->n = NULL;
 	s->m = NULL;
 	return s;
 }
 
-extern void assign(List *s1, List *s2, bool stack) {
-	List *val = s2;
+/* complain about a name which cannot be assigned to */
+
+extern void checkvarname(List *s1) {
 	if (s1 == NULL)
 		rc_error("null variable name");
 	if (s1->n != NULL)
@@ -212,20 +223,98 @@ extern void assign(List *s1, List *s2, bool stack) {
 		rc_error("numeric variable name");
 	if (strchr(s1->w, '=') != NULL)
 		rc_error("'=' in variable name");
+}
+
+extern void assign(List *s1, List *s2, bool stack) {
+	List *val = s2;
+	checkvarname(s1);
 	if (*s1->w == '*' && s1->w[1] == '\0')
 		val = append(varlookup("0"), s2); /* preserve $0 when * is assigned explicitly */
 	if (s2 != NULL || stack) {
 		if (dashex)
-			prettyprint_var(2, s1->w, val);
+			tracevar(s1->w, val);
 		varassign(s1->w, val, stack);
 		alias(s1->w, varlookup(s1->w), stack);
 	} else {
 		if (dashex)
-			prettyprint_var(2, s1->w, NULL);
+			tracevar(s1->w, NULL);
 		varrm(s1->w, stack);
 	}
 }
 
+static bool isvar(Node *n, char *name) {
+	return n->type == nVar && n->u[0].p->type == nWord && streq(n->u[0].p->u[0].s, name);
+}
+
+/*
+   An assignment x = ($x ...) or x = $x^..., which is how values are
+   built up in a loop, extends the value of x in place if it can (see
+   varappend() and varconcat()). Returns FALSE for other assignments.
+*/
+
+extern bool selfassign(Node *lhs, Node *rhs) {
+	Node *w, **spine;
+	List *name, *old, *s, **pieces;
+	char *piece, *p;
+	int i, depth;
+	size_t len;
+	bool simple;
+
+	if (lhs->type != nWord || rhs == NULL)
+		return FALSE;
+	name = glom(lhs);
+	if (rhs->type == nLappend) {
+		for (w = rhs; w->type == nLappend; w = w->u[0].p)
+			;
+		if (!isvar(w, name->w))
+			return FALSE;
+		checkvarname(name);
+		old = glom(w);
+		s = glob(glomargs(rhs, TRUE));
+		if (!varappend(name->w, old, s)) {
+			assign(name, append(old, s), FALSE);
+			return TRUE;
+		}
+	} else if (rhs->type == nConcat) {
+		for (depth = 0, w = rhs; w->type == nConcat; w = w->u[0].p)
+			depth++;
+		if (!isvar(w, name->w))
+			return FALSE;
+		checkvarname(name);
+		spine = nalloc(depth * sizeof *spine);
+		for (i = depth, w = rhs; i > 0; w = w->u[0].p)
+			spine[--i] = w;
+		old = glom(w);
+		pieces = nalloc(depth * sizeof *pieces);
+		simple = old != NULL && old->n == NULL;
+		for (i = 0, len = 0; i < depth; i++) {
+			pieces[i] = glom(spine[i]->u[1].p);
+			if (pieces[i] == NULL || pieces[i]->n != NULL || pieces[i]->m != NULL)
+				simple = FALSE;
+			else
+				len += strlen(pieces[i]->w);
+		}
+		if (simple) { /* copied, since a piece may be old itself */
+			p = piece = nalloc(len + 1);
+			for (i = 0; i < depth; i++) {
+				strcpy(p, pieces[i]->w);
+				p += strlen(p);
+			}
+			simple = varconcat(name->w, old, piece);
+		}
+		if (!simple) {
+			for (s = old, i = 0; i < depth; i++)
+				s = concat(s, pieces[i]);
+			assign(name, glob(s), FALSE);
+			return TRUE;
+		}
+	} else
+		return FALSE;
+	if (dashex)
+		tracevar(name->w, varlookup(name->w));
+	return TRUE;
+}
+
 /*
    The following two functions are by the courtesy of Paul Haahr,
    who could not stand the incompetence of my own backquote implementation.
@@ -233,7 +322,7 @@ extern void assign(List *s1, List *s2, bool stack) {
 
 #define BUFSIZE	((size_t) 1000)
 
-static List *bqinput(List *ifs, int fd) {
+extern List *bqinput(List *ifs, int fd) {
 	char *end, *bufend, *s;
 	List *r, *top, *prev;
 	size_t remain, bufsize;
@@ -322,12 +411,14 @@ static List *backq(Node *ifs, Node *n) {
 		close(p[0]);
 		redirq = NULL;
 		walk(n, FALSE);
-		exit(getstatus());
+		childexit(getstatus());
 	}
+	RC_PROBE1(backq__start, pid);
 	close(p[1]);
 	bq = bqinput(glom(ifs), p[0]);
 	close(p[0]);
 	rc_wait4(pid, &sp, TRUE);
+	RC_PROBE2(backq__done, pid, sp);
 	if (interactive && WIFSIGNALED(sp))
 		tcsetattr(0, TCSANOW, &t);
 	setstatus(-1, sp);
@@ -336,19 +427,49 @@ static List *backq(Node *ifs, Node *n) {
 	return bq;
 }
 
+/*
+   Everyone else empties the queue by setting redirq to NULL, so the
+   tail pointer is only trusted while the queue is non-empty.
+*/
+
 extern void qredir(Node *n) {
-	Rq *next;
-	if (redirq == NULL) {
-		next = redirq = nnew(Rq);
-	} else {
-		for (next = redirq; next->n != NULL; next = next->n)
-			;
-		next->n = nnew(Rq);
-		next = next->n;
-	}
+	Rq *next = nnew(Rq);
 	next->r = n;
 	next->n = NULL;
+	if (redirq == NULL)
+		redirq = next;
+	else
+		redirtail->n = next;
+	redirtail = next;
+}
+
+/*
+   <<{cmd} runs cmd to completion with its output in a regular file,
+   which the consumer can then lseek(2) and stat(2), unlike a pipe.
+*/
+
+#if HAVE_DEV_FD || HAVE_PROC_SELF_FD || HAVE_FIFO
+static void mkseekfile(Node *n, int fd) {
+	int sp;
+	pid_t pid;
+	struct termios t;
+	if (interactive)
+		tcgetattr(0, &t);
+	if ((pid = rc_fork()) == 0) {
+		setsigdefaults(FALSE);
+		if (mvfd(fd, 1) < 0)
+			childexit(1);
+		redirq = NULL;
+		walk(n->u[2].p, FALSE);
+		childexit(getstatus());
+	}
+	rc_wait4(pid, &sp, TRUE);
+	if (interactive && WIFSIGNALED(sp))
+		tcsetattr(0, TCSANOW, &t);
+	lseek(fd, 0, SEEK_SET);
+	sigchk();
 }
+#endif
 
 #if HAVE_DEV_FD || HAVE_PROC_SELF_FD
 static List *mkcmdarg(Node *n) {
@@ -357,6 +478,23 @@ static List *mkcmdarg(Node *n) {
 	Estack *e = nnew(Estack);
 	Edata efd;
 	int p[2];
+	if (n->u[0].i == rHeredoc) {
+		if ((p[0] = rc_tmpfd()) < 0) {
+			uerror("tmpfile");
+			return NULL;
+		}
+		efd.fd = p[0];
+		except(eFd, efd, e);
+		mkseekfile(n, p[0]);
+#if HAVE_DEV_FD
+		ret->w = nprint("/dev/fd/%d", p[0]);
+#else
+		ret->w = nprint("/proc/self/fd/%d", p[0]);
+#endif
+		ret->m = NULL;
+		ret->n = NULL;
+		return ret;
+	}
 	if (pipe(p) < 0) {
 		uerror("pipe");
 		return NULL;
@@ -364,11 +502,11 @@ static List *mkcmdarg(Node *n) {
 	if (rc_fork() == 0) {
 		setsigdefaults(FALSE);
 		if (mvfd(p[n->u[0].i == rFrom], n->u[0].i == rFrom) < 0) /* stupid hack */
-			exit(1);
+			childexit(1);
 		close(p[n->u[0].i != rFrom]);
 		redirq = NULL;
 		walk(n->u[2].p, FALSE);
-		exit(getstatus());
+		childexit(getstatus());
 	}
 
 #if HAVE_DEV_FD
@@ -403,6 +541,20 @@ static List *mkcmdarg(Node *n) {
 	static int fifonumber = 0;
 
 	name = nprint("/tmp/rc%d.%d", getpid(), fifonumber++);
+	if (n->u[0].i == rHeredoc) {
+		if ((fd = open(name, O_RDWR|O_CREAT|O_EXCL, 0600)) < 0) {
+			uerror(name);
+			return NULL;
+		}
+		efifo.name = name;
+		except(eFifo, efifo, e);
+		mkseekfile(n, fd);
+		close(fd);
+		ret->w = name;
+		ret->m = NULL;
+		ret->n = NULL;
+		return ret;
+	}
 	if (mkfifo(name, 0666) < 0) {
 		uerror("mkfifo");
 		return NULL;
@@ -412,13 +564,13 @@ static List *mkcmdarg(Node *n) {
 		fd = rc_open(name, (n->u[0].i != rFrom) ? rFrom : rCreate); /* stupid hack */
 		if (fd < 0) {
 			uerror("open");
-			exit(1);
+			childexit(1);
 		}
 		if (mvfd(fd, (n->u[0].i == rFrom)) < 0) /* same stupid hack */
-			exit(1);
+			childexit(1);
 		redirq = NULL;
 		walk(n->u[2].p, FALSE);
-		exit(getstatus());
+		childexit(getstatus());
 	}
 	efifo.name = name;
 	except(eFifo, efifo, e);
@@ -437,29 +589,62 @@ static List *mkcmdarg(Node *n) {
 
 #endif
 
+/*
+   Build the list for an nArgs/nLappend spine. The spine is left-deep,
+   so it is first flattened into an array and then evaluated left to
+   right, with each word appended at the tail of the result. Cells of
+   a variable's value are copied once; the final element is shared, as
+   append() used to do. If rest is set, the leftmost word is left out.
+*/
+
+static List *glomargs(Node *n, bool rest) {
+	Node **spine, *w;
+	List *top, **end, *v;
+	int i, depth;
+
+	for (depth = 0, w = n; w != NULL && (w->type == nArgs || w->type == nLappend); w = w->u[0].p)
+		depth++;
+	spine = nalloc(depth * sizeof *spine);
+	for (i = depth, w = n; i > 0; w = w->u[0].p)
+		spine[--i] = w;
+	top = NULL;
+	end = &top;
+	for (i = -1; i < depth; i++) {
+		Node *item = (i >= 0) ? spine[i]->u[1].p : rest ? NULL : w;
+		if (item == NULL)
+			continue;
+		if (item->type == nWord) {
+			if ((*end = word(item->u[0].s, item->u[1].s)) != NULL)
+				end = &(*end)->n;
+			continue;
+		}
+		v = glom(item);
+		if (i == depth - 1) {
+			*end = v;
+			return top;
+		}
+		for (; v != NULL; v = v->n) {
+			*end = nnew(List);
+			(*end)->w = v->w;
+			(*end)->m = v->m;
+			end = &(*end)->n;
+		}
+	}
+	*end = NULL;
+	return top;
+}
+
 extern List *glom(Node *n) {
-	List *v, *head, *tail;
-	Node *words;
+	List *v, *head;
+	bool star;
 	if (n == NULL)
 		return NULL;
 	switch (n->type) {
 	case nArgs:
 	case nLappend:
-		words = n->u[0].p;
-		tail = NULL;
-		while (words != NULL && (words->type == nArgs || words->type == nLappend)) {
-			if (words->u[1].p != NULL && words->u[1].p->type != nWord)
-				break;
-			head = glom(words->u[1].p);
-			if (head != NULL) {
-				head->n = tail;
-				tail = head;
-			}
-			words = words->u[0].p;
-		}
-		v = append(glom(words), tail); /* force left to right evaluation */
-		return append(v, glom(n->u[1].p));
+		return glomargs(n, FALSE);
 	case nBackq:
+	case nFuture: /* other than in an assignment, like a backquote */
 		return backq(n->u[0].p, n->u[1].p);
 	case nConcat:
 		head = glom(n->u[0].p); /* force left-to-right evaluation */
@@ -484,14 +669,17 @@ extern List *glom(Node *n) {
 			rc_error("multi-word variable name");
 		if (*v->w == '\0')
 			rc_error("zero-length variable name");
-		v = (*v->w == '*' && v->w[1] == '\0') ? varlookup(v->w)->n : varlookup(v->w);
+		star = (*v->w == '*' && v->w[1] == '\0');
+		if (n->type == nCount) { /* stored values know their length */
+			int nel = varnel(v->w);
+			return count(star && nel > 0 ? nel - 1 : nel);
+		}
+		v = star ? varlookup(v->w)->n : varlookup(v->w);
 		switch (n->type) {
 		default:
 			panic("unexpected node in glom");
 			exit(1);
 			/* NOTREACHED */
-		case nCount:
-			return count(v);
 		case nFlat:
 			return flatten(v);
 		case nVar:
@@ -9,6 +9,7 @@
 */
 
 #include "rc.h"
+#include "interp.h"
 #include "sigmsgs.h"
 
 static bool var_exportable(char *);
@@ -161,12 +162,17 @@ extern Variable *get_var_place(char *s, bool stack) {
 		} else {	/* trample the top of the stack */
 			new = vp[h].p;
 			efree(new->extdef);
-			listfree(new->def);
+			valfree(new->val);
 			return new;
 		}
 	}
 }
 
+/* Note that a variable was modified in place, so the environment must be rebuilt. */
+extern void set_env_dirty() {
+	env_dirty = TRUE;
+}
+
 /* Upsert the path associated to a command. We do not make a copy of
    the path string, but simply copy its pointer. Because of this,
    the whole table must be reset when $path is modified. */
@@ -205,14 +211,14 @@ extern void delete_var(char *s, bool stack) {
 	env_dirty = TRUE;
 	v = vp[h].p;
 	efree(v->extdef);
-	listfree(v->def);
+	valfree(v->val);
 	if (v->n != NULL) { /* This is the top of a stack */
 		if (stack) { /* pop */
 			vp[h].p = v->n;
 			efree(v);
 		} else { /* else just empty */
 			v->extdef = NULL;
-			v->def = NULL;
+			v->val = NULL;
 		}
 	} else { /* needs to be removed from the hash table */
 		efree(v);
@@ -255,6 +261,42 @@ extern void reset_cmdtab() {
 	cused = 0;
 }
 
+/* remove every function and variable, so that librc can start afresh */
+
+/* free the tables themselves, once clearhash() has emptied them */
+
+extern void freehash() {
+	efree(fp);
+	efree(vp);
+	efree(cp);
+	efree(env);
+	fp = vp = cp = NULL;
+	env = NULL;
+}
+
+extern void clearhash() {
+	char *name;
+	int i;
+	for (i = 0; i < fsize; i++)
+		if (fp[i].name != NULL && fp[i].name != dead) {
+			name = ecpy(fp[i].name);
+			fnrm(name); /* not delete_fn(): signal handlers must be reset */
+			efree(name);
+		}
+	for (i = 0; i < vsize; i++)
+		while (vp[i].name != NULL && vp[i].name != dead) {
+			name = ecpy(vp[i].name);
+			delete_var(name, TRUE);
+			efree(name);
+		}
+	reset_cmdtab();
+	efree(env);
+	env = NULL;
+	bozosize = envsize = 0;
+	env_dirty = TRUE;
+	tracechange();
+}
+
 static void free_fn(rc_Function *f) {
 	treefree(f->def);
 	efree(f->extdef);
@@ -291,6 +333,14 @@ static struct nameflag maybeexport[] = {
 	{ "version", FALSE }
 };
 
+const Region hashglobals[] = {
+	REGION(fp), REGION(vp), REGION(cp),
+	REGION(fused), REGION(fsize), REGION(vused), REGION(vsize),
+	REGION(cused), REGION(csize), REGION(env), REGION(bozosize),
+	REGION(envsize), REGION(env_dirty), REGION(maybeexport),
+	{ NULL, 0 }
+};
+
 void set_exportable(char *s, bool b) {
 	int i;
 	for (i = 0; i < arraysize(maybeexport); ++i)
@@ -3,6 +3,7 @@
 #include "rc.h"
 
 #include "input.h"
+#include "interp.h"
 
 struct Hq {
 	Node *doc;
@@ -13,6 +14,11 @@ struct Hq {
 
 static bool dead = FALSE;
 
+const Region heredocglobals[] = {
+	REGION(hq), REGION(dead),
+	{ NULL, 0 }
+};
+
 /*
  * read in a heredocument. A clever trick: skip over any partially matched end-of-file
  * marker storing only the number of characters matched. If the whole marker is matched,
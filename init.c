@@ -0,0 +1,59 @@
+/* init.c: the shell's global flags, and its default variables */
+
+#include "rc.h"
+
+#include "interp.h"
+
+bool dashdee, dashee, dasheye, dashell, dashen;
+bool dashpee, dashoh, dashess, dashvee, dashex;
+bool interactive;
+bool embedded; /* running inside librc, not as a process of its own */
+char *dashsee[2];
+pid_t rc_pid;
+pid_t rc_ppid;
+
+const Region initglobals[] = {
+	REGION(dashdee), REGION(dashee), REGION(dasheye), REGION(dashell),
+	REGION(dashen), REGION(dashpee), REGION(dashoh), REGION(dashess),
+	REGION(dashvee), REGION(dashex), REGION(interactive), REGION(dashsee),
+	{ NULL, 0 }
+};
+
+static void assigndefault(char *,...);
+
+/* assign the default variables, then import the environment over them */
+
+extern void initvars(char **envp) {
+	assigndefault("ifs", " ", "\t", "\n", (void *)0);
+	assigndefault("ofs", " ", (void *)0);
+	assigndefault("nl", "\n", (void *)0);
+#ifdef DEFAULTPATH
+	assigndefault("path", DEFAULTPATH, (void *)0);
+#endif
+	assigndefault("pid", nprint("%d", rc_pid), (void *)0);
+	assigndefault("ppid", nprint("%d", rc_ppid), (void *)0);
+	assigndefault("prompt", "; ", "", (void *)0);
+	assigndefault("tab", "\t", (void *)0);
+	assigndefault("version",
+		VERSION,
+		"$Release: @(#)" PACKAGE " " VERSION " " DESCRIPTION " $",
+		(void *)0 );
+	assigndefault("noexport",
+		"noexport", "apid", "apids", "bqstatus", "cdpath", "cwd", "home",
+		"ifs", "ofs", "path", "pid", "ppid", "status", "*", (void *)0);
+	initenv(envp);
+}
+
+static void assigndefault(char *name,...) {
+	va_list ap;
+	List *l;
+	char *v;
+	va_start(ap, name);
+	for (l = NULL; (v = va_arg(ap, char *)) != NULL;)
+		l = append(l, word(v, NULL));
+	varassign(name, l, FALSE);
+	set_exportable(name, FALSE);
+	if (streq(name, "path"))
+		alias(name, l, FALSE);
+	va_end(ap);
+}
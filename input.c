@@ -3,11 +3,14 @@
 #include "rc.h"
 
 #include <errno.h>
+#include <fcntl.h>
 
 #include "develop.h"
 #include "edit.h"
 #include "input.h"
+#include "interp.h"
 #include "jbwrap.h"
+#include "probe.h"
 
 /* How many characters can we unget? */
 enum { UNGETSIZE = 2 };
@@ -37,6 +40,13 @@ int lastchar;
 
 static char *prompt, *prompt2;
 
+const Region inputglobals[] = {
+	REGION(inbuf), REGION(istacksize), REGION(chars_out), REGION(chars_in),
+	REGION(save_lineno), REGION(istack), REGION(itop), REGION(lastchar),
+	REGION(prompt), REGION(prompt2),
+	{ NULL, 0 }
+};
+
 extern void ugchar(int c) {
 	assert(istack->ungetcount < UNGETSIZE);
 	istack->ungetbuf[istack->ungetcount++] = c;
@@ -168,6 +178,13 @@ extern void initinput() {
 	ugchar(EOF);
 }
 
+/* free the input stack, which must be back at the "dead" input */
+
+extern void freeinput() {
+	efree(itop);
+	istack = itop = NULL;
+}
+
 /* push an input source onto the stack. set up a new input buffer, and set gchar() */
 
 static void pushcommon() {
@@ -194,6 +211,8 @@ extern void pushfd(int fd) {
 	save_lineno = TRUE;
 	istack->fd = fd;
 	lineno = 1;
+	if (fd > 2)
+		fcntl(fd, F_SETFD, FD_CLOEXEC); /* no child should read it */
 	if (editing && interactive && isatty(fd)) {
 		istack->t = iEdit;
 		istack->gchar = editgchar;
@@ -257,6 +276,7 @@ extern void skiptonl() {
 extern Node *doit(bool clobberexecit) {
 	bool eof;
 	bool execit;
+	int r;
 	Jbwrap j;
 	Estack e1;
 	Edata jerror;
@@ -265,6 +285,7 @@ extern Node *doit(bool clobberexecit) {
 		clobberexecit = FALSE;
 	execit = clobberexecit;
 	sigsetjmp(j.j, 1);
+	flushredirs();
 	jerror.jb = &j;
 	except(eError, jerror, &e1);
 	for (eof = FALSE; !eof;) {
@@ -277,16 +298,8 @@ extern Node *doit(bool clobberexecit) {
 
 		if (interactive) {
 			List *s;
-			if (!dashen && fnlookup("prompt") != NULL) {
-				static bool died = FALSE;
-				static char *arglist[] = { "prompt", NULL };
-
-				if (!died) {
-					died = TRUE;
-					funcall(arglist);
-				}
-				died = FALSE;
-			}
+			if (!dashen && fnlookup("prompt") != NULL)
+				runprompt();
 			s = varlookup("prompt");
 			if (s != NULL) {
 				prompt = s->w;
@@ -303,8 +316,14 @@ extern Node *doit(bool clobberexecit) {
 				edit_prompt(istack->cookie, prompt);
 		}
 		inityy();
-		if (yyparse() == 1 && execit)
+		RC_PROBE0(parse__start);
+		r = yyparse();
+		RC_PROBE1(parse__done, parsetree);
+		if (r == 1 && execit) {
+			if (embedded)
+				set(FALSE); /* as rc would exit(1) */
 			rc_raise(eError);
+		}
 		eof = (lastchar == EOF); /* "lastchar" can be clobbered during a walk() */
 		if (parsetree != NULL) {
 			if (RC_DEVELOP)
@@ -312,8 +331,9 @@ extern Node *doit(bool clobberexecit) {
 			if (execit)
 				walk(parsetree, TRUE);
 			else if (dashex && dashen)
-				fprint(2, "%T\n", parsetree);
+				tracetree(parsetree);
 		}
+		flushredirs();
 		unexcept(eArena);
 	}
 	popinput();
@@ -336,17 +356,6 @@ extern Node *parseline(char *extdef) {
 	return fun;
 }
 
-/* close file descriptors after a fork() */
-
-extern void closefds() {
-	Input *i;
-	for (i = istack; i != itop; --i)	/* close open scripts */
-		if (i->t == iFd && i->fd > 2) {
-			close(i->fd);
-			i->fd = -1;
-		}
-}
-
 /* print (or set) prompt(2) */
 
 extern void nextline() {
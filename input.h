@@ -1,5 +1,6 @@
 /* initialize the input stack */
 extern void initinput(void);
+extern void freeinput(void);
 
 /* push an input onto the stack */
 extern void pushfd(int);
@@ -28,8 +29,5 @@ extern void skiptonl(void);
 /* prepare for next line of input */
 extern void nextline(void);
 
-/* close all file descriptors on the stack */
-extern void closefds(void);
-
 /* the last character read */
 extern int lastchar;
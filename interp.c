@@ -0,0 +1,122 @@
+/* interp.c: more than one interpreter in a process */
+
+#include "rc.h"
+
+#include <signal.h>
+
+#include "input.h"
+#include "interp.h"
+
+/*
+   An interpreter's state is kept where it always has been, in the
+   globals of each module (function-local statics included, which have
+   been moved out for the purpose), which lists them in a table of
+   Regions. An Interp holds a copy of all of them: making another
+   interpreter the current one saves the globals into the current one's
+   copy, and loads the other's. That costs a few kilobytes of copying,
+   once per call into librc rather than once per access. It is not a
+   context which each module reaches through a pointer, so only one
+   interpreter in a process can run at a time, and none can run on
+   another thread.
+
+   Signal functions belong to an interpreter, and the dispositions they
+   need are installed when it becomes the current one; a signal is
+   handled by the interpreter which is current when it arrives. The
+   trace buffer is flushed rather than copied.
+
+   What belongs to the process is shared: the children rc has forked
+   (any interpreter may reap them), the make jobserver, file
+   descriptors, the current directory, tables which do not change once
+   made, and scratch space which holds nothing between calls (glob.c's
+   and which.c's buffers).
+*/
+
+struct Interp {
+	char *save;
+};
+
+static const Region *const modules[] = {
+	builtinsglobals, exceptglobals, fnglobals, footobarglobals,
+	futureglobals, globglobals, glomglobals, hashglobals, heredocglobals,
+	initglobals, inputglobals, lexglobals, listglobals, nallocglobals,
+	parseglobals, promptglobals, redirglobals, signalglobals,
+	statusglobals, traceglobals, varglobals, walkglobals
+};
+
+static char *pristine;	/* the globals as they were when rc started */
+static size_t total;
+static Interp *current;
+
+static void copyout(char *save) {
+	const Region *r;
+	int i;
+	for (i = 0; i < arraysize(modules); i++)
+		for (r = modules[i]; r->p != NULL; r++) {
+			memcpy(save, r->p, r->n);
+			save += r->n;
+		}
+}
+
+static void copyin(char *save) {
+	const Region *r;
+	int i;
+	for (i = 0; i < arraysize(modules); i++)
+		for (r = modules[i]; r->p != NULL; r++) {
+			memcpy(r->p, save, r->n);
+			save += r->n;
+		}
+}
+
+extern Interp *newinterp() {
+	Interp *i;
+	if (pristine == NULL) {
+		const Region *r;
+		int m;
+		for (m = 0; m < arraysize(modules); m++)
+			for (r = modules[m]; r->p != NULL; r++)
+				total += r->n;
+		copyout(pristine = ealloc(total));
+	}
+	i = enew(Interp);
+	i->save = ealloc(total);
+	memcpy(i->save, pristine, total);
+	return i;
+}
+
+/* signals are held off while the globals (including those of signal.c) are exchanged */
+
+extern void useinterp(Interp *i) {
+	sigset_t all, old;
+	if (i == current)
+		return;
+	sigfillset(&all);
+	sigprocmask(SIG_SETMASK, &all, &old);
+	if (current != NULL) {
+		traceflush();
+		copyout(current->save);
+	}
+	copyin(i->save);
+	syncsignals();
+	current = i;
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+extern void freeinterp(Interp *i) {
+	useinterp(i);
+	clearhash();
+	freehash();
+	dropfutures();
+	forgetprompt();
+	flushredirs();
+	traceclose();
+	forgetdirs();
+	freevals();
+	freeinput();
+	freelex();
+	freeblocks();
+	copyin(pristine);
+	syncsignals(); /* back to the program's own */
+	efree(i->save);
+	efree(i);
+	current = NULL;
+}
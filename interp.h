@@ -0,0 +1,30 @@
+/* interp.h: more than one interpreter in a process; see interp.c */
+
+typedef struct Interp Interp;
+
+/* a piece of an interpreter's state: one of a module's globals */
+typedef struct Region {
+	void *p;
+	size_t n;
+} Region;
+
+#define REGION(v) { &(v), sizeof (v) }
+
+/* the globals of each module which belong to an interpreter, ending with { NULL, 0 } */
+extern const Region builtinsglobals[], exceptglobals[], fnglobals[];
+extern const Region futureglobals[], globglobals[], glomglobals[];
+extern const Region hashglobals[], heredocglobals[], initglobals[];
+extern const Region inputglobals[], lexglobals[], listglobals[];
+extern const Region nallocglobals[], parseglobals[], promptglobals[];
+extern const Region footobarglobals[], redirglobals[], signalglobals[];
+extern const Region statusglobals[], traceglobals[], varglobals[];
+extern const Region walkglobals[];
+
+/* a new interpreter, with every global as it was when rc started */
+extern Interp *newinterp(void);
+
+/* make an interpreter the current one */
+extern void useinterp(Interp *);
+
+/* free an interpreter and everything it holds; there is then no current one */
+extern void freeinterp(Interp *);
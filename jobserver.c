@@ -0,0 +1,163 @@
+/* jobserver.c: sharing make's job slots with a parallel make */
+
+#include "rc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "stat.h"
+
+/*
+   Under make -jN, $MAKEFLAGS names the jobserver: a pipe, either as a
+   pair of inherited fds (--jobserver-auth=R,W or the older
+   --jobserver-fds=R,W) or as a named fifo (--jobserver-auth=fifo:PATH).
+   The pipe holds one byte for each free job slot. rc itself runs in a
+   slot of its own, and takes a byte before starting each extra child
+   that runs alongside it, which is handed back once the child is
+   reaped. $MAKEFLAGS is read the first time a slot is wanted. rc
+   opens the pipe afresh, read-write and non-blocking, so that it never
+   sleeps in read() while another process takes the last byte, and
+   never sees end of file. Where an inherited pipe cannot be reopened
+   (there is no /proc), rc reads and writes copies of make's own fds;
+   their non-blocking flag is shared with make and must be left alone,
+   so rc polls a blocking one before reading (and waits in read() if
+   another process takes the byte in between).
+*/
+
+static int jobfd = -1, jobwfd = -1; /* the same fd, unless make's are shared */
+static bool looked = FALSE, jobblocks = FALSE;
+
+static bool isfifo(int fd) {
+	struct stat st;
+	return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+static bool jobusable(int fd) {
+	return fcntl(fd, F_GETFD) >= 0 && isfifo(fd);
+}
+
+static int jobopen(char *path) {
+	int fd = open(path, O_RDWR|O_NONBLOCK);
+	if (fd < 0)
+		return -1;
+	if (!isfifo(fd)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* the last jobserver named in $MAKEFLAGS, as make itself reads it */
+
+static void jobinit(void) {
+	char *auth = NULL, *s, *t, *path;
+	List *l;
+	int r, w, fd = -1;
+
+	looked = TRUE;
+	for (l = varlookup("MAKEFLAGS"); l != NULL; l = l->n)
+		for (s = l->w; (t = strstr(s, "--jobserver-")) != NULL; s = t + 1)
+			if (strncmp(t, "--jobserver-auth=", 17) == 0)
+				auth = t + 17;
+			else if (strncmp(t, "--jobserver-fds=", 16) == 0)
+				auth = t + 16;
+	if (auth == NULL)
+		return;
+	if (strncmp(auth, "fifo:", 5) == 0) {
+		for (t = auth += 5; *t != '\0' && *t != ' '; t++)
+			;
+		path = nalloc(t - auth + 1);
+		memcpy(path, auth, t - auth);
+		path[t - auth] = '\0';
+		fd = jobopen(path);
+	} else {
+		/* make closes the fds for commands it does not think are makes */
+		r = strtol(auth, &s, 10);
+		if (s != auth && *s == ',') {
+			w = strtol(t = s + 1, &s, 10);
+			if (s != t && jobusable(r) && jobusable(w)) {
+#if HAVE_PROC_SELF_FD
+				fd = jobopen(nprint("/proc/self/fd/%d", r));
+#endif
+				if (fd < 0) {
+					jobfd = highfd(dup(r));
+					jobwfd = highfd(dup(w));
+					jobblocks = (fcntl(r, F_GETFL) & O_NONBLOCK) == 0;
+					if (jobfd >= 0 && jobwfd >= 0)
+						return;
+					close(jobfd);
+					close(jobwfd);
+					jobfd = jobwfd = -1;
+				}
+			}
+		}
+	}
+	if (fd < 0) {
+		fprint(2, RC "cannot use the jobserver named in $MAKEFLAGS\n");
+		return;
+	}
+	jobfd = jobwfd = highfd(fd);
+}
+
+static void jobclose(void) {
+	if (jobwfd != jobfd)
+		close(jobwfd);
+	close(jobfd);
+	jobfd = jobwfd = -1;
+}
+
+/*
+   Take a job slot if there is one free: returns the byte read, or -1,
+   with errno EAGAIN if the slot must be waited for (on jobfd()), and 0
+   if there is no jobserver.
+*/
+
+extern int jobtake(void) {
+	unsigned char c;
+	int n;
+	if (!looked)
+		jobinit();
+	if (jobfd < 0) {
+		errno = 0;
+		return -1;
+	}
+	if (jobblocks) {
+		struct pollfd p;
+		p.fd = jobfd;
+		p.events = POLLIN;
+		if ((n = poll(&p, 1, 0)) <= 0) {
+			if (n == 0)
+				errno = EAGAIN;
+			return -1;
+		}
+	}
+	switch (read(jobfd, &c, 1)) {
+	case 1:
+		return c;
+	case 0: /* cannot happen, since rc holds the write end too */
+		jobclose();
+		errno = 0;
+		return -1;
+	default:
+		if (errno != EINTR && errno != EAGAIN) {
+			jobclose();
+			errno = 0;
+		}
+		return -1;
+	}
+}
+
+extern int jobpipe(void) {
+	return jobfd;
+}
+
+/* hand back a slot taken with jobtake() */
+
+extern void jobgive(int c) {
+	unsigned char b = c;
+	if (c < 0 || jobwfd < 0)
+		return;
+	while (write(jobwfd, &b, 1) < 0 && errno == EINTR)
+		;
+}
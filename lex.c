@@ -3,6 +3,7 @@
 #include "rc.h"
 
 #include "input.h"
+#include "interp.h"
 #include "parse.h"
 
 /*
@@ -78,6 +79,14 @@ static bool errset = FALSE;
 static bool prerror = FALSE;
 static wordstates w = NW;
 static int fd_left, fd_right;
+static bool dollar = FALSE;
+
+const Region lexglobals[] = {
+	REGION(lineno), REGION(bufsize), REGION(realbuf), REGION(newline),
+	REGION(errset), REGION(prerror), REGION(w), REGION(fd_left),
+	REGION(fd_right), REGION(dollar),
+	{ NULL, 0 }
+};
 
 #define checkfreecaret {if (w != NW) { w = NW; ugchar(c); return '^'; }}
 
@@ -98,7 +107,6 @@ extern bool quotep(char *s, bool dollar) {
 }
 
 extern int yylex() {
-	static bool dollar = FALSE;
 	bool saw_meta = FALSE;
 	int c;
 	size_t i;			/* The purpose of all these local assignments is to	*/
@@ -195,6 +203,8 @@ top:	while ((c = gchar()) == ' ' || c == '\t')
 		c = gchar();
 		if (c == '`')
 			return BACKBACK;
+		if (c == '&')
+			return FUTURE;
 		ugchar(c);
 		return '`';
 	case '$':
@@ -317,7 +327,12 @@ top:	while ((c = gchar()) == ' ' || c == '\t')
 				y->redir.fd = fd_left;
 				return SREDIR;
 			}
-			return (y->redir.type == rFrom || y->redir.type == rCreate) ? REDIR : SREDIR;
+			switch (y->redir.type) {
+			case rFrom: case rCreate: case rHeredoc:
+				return REDIR; /* may be followed by a brace */
+			default:
+				return SREDIR;
+			}
 		} else { /* dup; recast yylval */
 			y->dup.type = y->redir.type;
 			y->dup.left = fd_left;
@@ -356,6 +371,12 @@ extern void scanerror(char *s) {
 	errset = prerror = TRUE;
 }
 
+extern void freelex() {
+	efree(realbuf);
+	realbuf = NULL;
+	bufsize = BUFSIZE;
+}
+
 extern void inityy() {
 	newline = FALSE;
 	w = NW;
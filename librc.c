@@ -0,0 +1,182 @@
+/* librc.c: the interpreter as a library; see librc.h */
+
+#include "rc.h"
+
+#include <locale.h>
+
+#include "input.h"
+#include "interp.h"
+#include "jbwrap.h"
+#include "librc.h"
+
+struct librc {
+	char **envp;
+	Interp *interp;
+};
+
+static int protect(void (*)(void *), void *, char **, size_t *);
+
+static void start(void *envp) {
+	char *null[1];
+	initvars(envp);
+	null[0] = NULL;
+	starassign("rc", null, FALSE);
+	set(TRUE);
+}
+
+extern librc *librc_new(char **envp) {
+	static bool initialized = FALSE;
+	librc *rc;
+	if (!initialized) {
+		embedded = TRUE;
+		initprint();
+		rc_pid = getpid();
+		rc_ppid = getppid();
+		initsignal();
+		initparse();
+		freeblocks(); /* initparse()'s scratch; each interpreter has its own arena */
+		initialized = TRUE;
+	}
+	rc = enew(librc);
+	rc->envp = envp;
+	rc->interp = newinterp();
+	useinterp(rc->interp);
+	inithash();
+	initinput();
+	inithandler();
+	protect(start, envp, NULL, NULL);
+	return rc;
+}
+
+extern void librc_free(librc *rc) {
+	freeinterp(rc->interp);
+	efree(rc);
+}
+
+/*
+   Call f(arg) as rc would run a command: on an arena of its own, with
+   errors (and exit) returning here rather than ending the program, and
+   with fd 1 sent to an anonymous file if the output is wanted.
+*/
+
+static int protect(void (*f)(void *), void *arg, char **out, size_t *outlen) {
+	Jbwrap j;
+	Estack e1, e2;
+	Edata jerror, block;
+	bool i = interactive;
+	int fd = -1, saved = -1;
+	off_t len;
+
+	if (out != NULL) {
+		*out = NULL;
+		if ((fd = rc_tmpfd()) < 0 || (saved = dup(1)) < 0 || dup2(fd, 1) < 0) {
+			if (fd >= 0)
+				close(fd);
+			if (saved >= 0)
+				close(saved);
+			return -1;
+		}
+	}
+	interactive = FALSE;
+	if (sigsetjmp(j.j, 1) == 0) {
+		jerror.jb = &j;
+		except(eError, jerror, &e1);
+		e1.interactive = TRUE; /* so that rc_raise() stops here */
+		block.b = newblock();
+		except(eArena, block, &e2);
+		(*f)(arg);
+		unexcept(eArena);
+		unexcept(eError);
+	}
+	interactive = i;
+	redirq = NULL;
+	if (out != NULL) {
+		dup2(saved, 1);
+		close(saved);
+		if ((len = lseek(fd, 0, SEEK_END)) < 0 || (*out = malloc(len + 1)) == NULL) {
+			close(fd);
+			return -1;
+		}
+		if (pread(fd, *out, len, 0) != len) {
+			free(*out);
+			*out = NULL;
+			close(fd);
+			return -1;
+		}
+		(*out)[len] = '\0';
+		if (outlen != NULL)
+			*outlen = len;
+		close(fd);
+	}
+	return getstatus();
+}
+
+static void runstring(void *cmds) {
+	char *in[2];
+	in[0] = cmds;
+	in[1] = NULL;
+	pushstring(in, TRUE);
+	doit(TRUE);
+}
+
+static void runfile(void *path) {
+	char *av[3];
+	av[0] = ".";
+	av[1] = path;
+	av[2] = NULL;
+	b_dot(av);
+}
+
+extern int librc_run(librc *rc, const char *cmds, char **out, size_t *outlen) {
+	useinterp(rc->interp);
+	return protect(runstring, (void *) cmds, out, outlen);
+}
+
+extern int librc_runfile(librc *rc, const char *path, char **out, size_t *outlen) {
+	useinterp(rc->interp);
+	return protect(runfile, (void *) path, out, outlen);
+}
+
+struct setvar {
+	const char *name;
+	char **values;
+};
+
+static void setvar(void *arg) {
+	struct setvar *v = arg;
+	List *l, **end = &l;
+	char **s;
+	for (s = v->values; s != NULL && *s != NULL; s++) {
+		*end = word(*s, NULL);
+		end = &(*end)->n;
+	}
+	*end = NULL;
+	assign(word((char *) v->name, NULL), l, FALSE);
+	set(TRUE);
+}
+
+extern int librc_setvar(librc *rc, const char *name, char **values) {
+	struct setvar v;
+	v.name = name;
+	v.values = values;
+	useinterp(rc->interp);
+	return protect(setvar, &v, NULL, NULL);
+}
+
+extern int librc_setfn(librc *rc, const char *name, const char *body) {
+	char *cmds = mprint("fn %S {%s\n}", name, body);
+	int status = librc_run(rc, cmds, NULL, NULL);
+	efree(cmds);
+	return status;
+}
+
+extern int librc_status(librc *rc) {
+	useinterp(rc->interp);
+	return getstatus();
+}
+
+extern void librc_reset(librc *rc) {
+	useinterp(rc->interp);
+	clearhash();
+	protect(start, rc->envp, NULL, NULL);
+}
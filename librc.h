@@ -0,0 +1,66 @@
+/* librc.h: running rc inside another program */
+
+/*
+   A program may have any number of interpreters, each with its own
+   variables, functions and input. They run in the calling process, one
+   call at a time. They are not thread-safe, and cannot run side by
+   side in separate threads: an interpreter's state is swapped into
+   rc's globals for each call. A program which uses them from more than
+   one thread must hold a lock of its own around every call. The current
+   directory and file descriptors belong to the whole process, as do
+   rc's children: commands that are not builtins or functions are forked
+   as usual, and rc reaps its children with wait(), so the program
+   should not have other children to wait for while a run is in
+   progress. rc leaves the program's signal handlers alone unless a
+   script defines a signal function (e.g., fn sigint); such a function
+   belongs to its interpreter, and its handler is in place only until
+   another interpreter is called. exec is refused, since it would
+   replace the program.
+
+   The interface may be used from C++.
+*/
+
+#ifndef LIBRC_H
+#define LIBRC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct librc librc;
+
+/* create the interpreter, importing variables and functions from envp */
+extern librc *librc_new(char **envp);
+
+/* destroy it */
+extern void librc_free(librc *);
+
+/* assign a list (NULL-terminated) to a variable; values == NULL deletes it */
+extern int librc_setvar(librc *, const char *name, char **values);
+
+/* define a function; body is rc source, without the braces */
+extern int librc_setfn(librc *, const char *name, const char *body);
+
+/*
+   Run commands, or the rc script in a file. If out is not NULL, the
+   standard output of the commands is collected, and *out is set to a
+   NUL-terminated buffer which the caller must free(); *outlen (if not
+   NULL) is set to its length. Returns the exit status rc would exit
+   with, or -1 if output could not be collected.
+*/
+extern int librc_run(librc *, const char *cmds, char **out, size_t *outlen);
+extern int librc_runfile(librc *, const char *path, char **out, size_t *outlen);
+
+/* the exit status of the last run */
+extern int librc_status(librc *);
+
+/* forget all variables and functions, and import the environment again */
+extern void librc_reset(librc *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
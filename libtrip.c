@@ -0,0 +1,158 @@
+/* This is an auxiliary test program for librc, run by "make trip". */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "librc.h"
+
+extern char **environ;
+
+static int failed = 0;
+static pid_t self;
+static int exits[2];	/* a byte for each process that ran atexit() handlers */
+
+static void atexitcheck(void) {
+	if (getpid() != self)
+		write(exits[1], "x", 1);
+}
+
+/* run cmds, checking its status and output; quiet discards rc's error messages */
+
+static void expect(librc *rc, const char *cmds, int status, const char *want, int quiet) {
+	char *out;
+	int s, saved = -1;
+	if (quiet) {
+		saved = dup(2);
+		close(2);
+		open("/dev/null", O_WRONLY);
+	}
+	s = librc_run(rc, cmds, &out, NULL);
+	if (quiet) {
+		dup2(saved, 2);
+		close(saved);
+	}
+	if (s != status || out == NULL || strcmp(out, want) != 0) {
+		fprintf(stderr, "librc: %s: got %d `%s', want %d `%s'\n",
+			cmds, s, out == NULL ? "(null)" : out, status, want);
+		failed = 1;
+	}
+	free(out);
+}
+
+/* does the file at path contain s? */
+
+static int contains(const char *path, const char *s) {
+	char buf[4096];
+	size_t n;
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return 0;
+	n = fread(buf, 1, sizeof buf - 1, f);
+	buf[n] = '\0';
+	fclose(f);
+	return strstr(buf, s) != NULL;
+}
+
+int main(void) {
+	static char *vals[] = { "a", "b c", NULL };
+	librc *rc = librc_new(environ), *other;
+	char c, here[4096];
+	FILE *in;
+
+	if (rc == NULL) {
+		fprintf(stderr, "librc: librc_new\n");
+		return 1;
+	}
+	expect(rc, "echo hello", 0, "hello\n", 0);
+	expect(rc, "/bin/echo forked; echo builtin", 0, "forked\nbuiltin\n", 0);
+	expect(rc, "false", 1, "", 0);
+	expect(rc, "exit 3; echo not reached", 3, "", 0);
+	expect(rc, "echo before\nif", 1, "before\n", 1);
+	expect(rc, "exec echo gone", 1, "", 1);
+	expect(rc, "echo still here", 0, "still here\n", 0);
+
+	librc_setvar(rc, "v", vals);
+	expect(rc, "echo $#v $v(2)", 0, "2 b c\n", 0);
+	librc_setfn(rc, "f", "echo f $*; return 2");
+	expect(rc, "f x y", 2, "f x y\n", 0);
+	if (librc_status(rc) != 2) {
+		fprintf(stderr, "librc: librc_status\n");
+		failed = 1;
+	}
+	expect(rc, "x=`{f z}; echo $x", 0, "f z\n", 0);
+
+	/* rc's children must not run the program's atexit() handlers */
+	self = getpid();
+	if (pipe(exits) < 0 || fcntl(exits[0], F_SETFL, O_NONBLOCK) < 0) {
+		fprintf(stderr, "librc: pipe\n");
+		return 1;
+	}
+	atexit(atexitcheck);
+	expect(rc, "{echo a} | cat; x=`{echo b}; exit 1 | true; sleep 0 &; wait", 0, "a\n", 0);
+	if (read(exits[0], &c, 1) > 0) {
+		fprintf(stderr, "librc: atexit() handler run in a child\n");
+		failed = 1;
+	}
+
+	if ((other = librc_new(environ)) == NULL) {
+		fprintf(stderr, "librc: a second librc_new\n");
+		return 1;
+	}
+	expect(other, "echo $#v; whatis f >[2]/dev/null", 1, "0\n", 0);
+	expect(other, "v=other; fn f {echo other f}; f; false", 1, "other f\n", 0);
+	expect(rc, "echo $v; f; echo $status", 0, "a b c\nf\n2\n", 0);
+	expect(other, "echo $v $status", 0, "other 1\n", 0);
+
+	/* each keeps its own signal functions, prompt and trace in turn */
+	if ((in = fopen("libtrip.in", "w")) == NULL || fputs("echo cmd\n", in) < 0 || fclose(in) != 0) {
+		fprintf(stderr, "librc: libtrip.in\n");
+		return 1;
+	}
+	expect(rc, "fn sigusr1 {echo trap}; xtrace=libtrip.rc.x; flag x +", 0, "", 0);
+	expect(other, "fn sigusr1 {}; xtrace=libtrip.other.x; flag x +", 0, "", 0);
+	expect(rc, "kill -USR1 $pid; echo rc", 0, "trap\nrc\n", 0);
+	expect(other, "kill -USR1 $pid; echo other", 0, "other\n", 0);
+	expect(rc, "kill -USR1 $pid; echo rc again", 0, "trap\nrc again\n", 0);
+	expect(rc, "promptcache=x; x=1; prompt=('' ''); fn prompt {echo prompt}; . -i libtrip.in", 0, "prompt\ncmd\n", 0);
+	expect(other, "promptcache=x; x=1; prompt=('' ''); fn prompt {echo prompt}; . -i libtrip.in", 0, "prompt\ncmd\n", 0);
+	expect(rc, ". -i libtrip.in", 0, "cmd\n", 0);
+	expect(other, "x=2; . -i libtrip.in", 0, "prompt\ncmd\n", 0);
+	expect(rc, "flag x -; fn sigusr1", 0, "", 0);
+	librc_free(other);
+	if (!contains("libtrip.rc.x", "echo rc again") || contains("libtrip.rc.x", "echo other")
+	    || !contains("libtrip.other.x", "echo other") || contains("libtrip.other.x", "echo rc")) {
+		fprintf(stderr, "librc: $xtrace of two interpreters\n");
+		failed = 1;
+	}
+	unlink("libtrip.in");
+	unlink("libtrip.rc.x");
+	unlink("libtrip.other.x");
+	expect(rc, "echo $#v", 0, "2\n", 0);
+
+	/* pwd notices a chdir() behind rc's back */
+	if (getcwd(here, sizeof here) == NULL) {
+		fprintf(stderr, "librc: getcwd\n");
+		return 1;
+	}
+	expect(rc, "cd /; pwd", 0, "/\n", 0);
+	if (chdir(here) < 0) {
+		fprintf(stderr, "librc: chdir\n");
+		return 1;
+	}
+	strcat(here, "\n");
+	expect(rc, "pwd", 0, here, 0);
+
+	librc_reset(rc);
+	expect(rc, "echo $#v; whatis f >[2]/dev/null", 1, "0\n", 0);
+	librc_free(rc);
+
+	if ((rc = librc_new(environ)) == NULL) {
+		fprintf(stderr, "librc: librc_new after librc_free\n");
+		return 1;
+	}
+	expect(rc, "echo again", 0, "again\n", 0);
+	return failed;
+}
@@ -2,6 +2,8 @@
 
 #include "rc.h"
 
+#include "interp.h"
+
 /*
    These list routines assign meta values of null to the resulting lists;
    it is impossible to glob with the value of a variable unless this value
@@ -55,3 +57,148 @@ extern int listnel(List *s) {
 		nel++;
 	return nel;
 }
+
+/*
+   Stored values. Once a list has been stored in a Value it is never
+   modified while anyone else holds a reference to it, so variables,
+   $* stacks and for loops can share one copy. A Value owns the first
+   "own" cells of its list; the cells after those belong to "share",
+   which it holds a reference to.
+
+   Every live Value is entered in a small hash table keyed by the
+   address of its first cell. That is how listval() recognizes that a
+   list handed to it (say, the result of glomming $x) is, or ends in,
+   a value which is already stored.
+*/
+
+static Value **vtab;
+static size_t vtsize, vtused;
+
+const Region listglobals[] = {
+	REGION(vtab), REGION(vtsize), REGION(vtused),
+	{ NULL, 0 }
+};
+
+#define vhash(l) (((size_t) (l) / sizeof (List)) & (vtsize - 1))
+
+/* Return the Value which begins at cell l, if there is one. */
+
+extern Value *valfind(List *l) {
+	Value *v;
+	if (vtused == 0)
+		return NULL;
+	for (v = vtab[vhash(l)]; v != NULL; v = v->link)
+		if (v->def == l)
+			return v;
+	return NULL;
+}
+
+static void valenter(Value *v) {
+	Value **h;
+	if (vtused >= vtsize) {
+		Value **old = vtab, *p, *q;
+		size_t i, oldsize = vtsize;
+		vtsize = (vtsize == 0) ? 64 : 2 * vtsize;
+		vtab = ecalloc(vtsize, sizeof *vtab);
+		for (i = 0; i < oldsize; i++)
+			for (p = old[i]; p != NULL; p = q) {
+				q = p->link;
+				h = &vtab[vhash(p->def)];
+				p->link = *h;
+				*h = p;
+			}
+		efree(old);
+	}
+	h = &vtab[vhash(v->def)];
+	v->link = *h;
+	*h = v;
+	vtused++;
+}
+
+static void valremove(Value *v) {
+	Value **h;
+	for (h = &vtab[vhash(v->def)]; *h != v; h = &(*h)->link)
+		;
+	*h = v->link;
+	vtused--;
+}
+
+static Value *valnew(List *def, int nel, int own, Value *share) {
+	Value *v = enew(Value);
+	v->refs = 1;
+	v->nel = nel;
+	v->own = own;
+	v->share = share;
+	v->def = def;
+	v->last = NULL;
+	v->len = v->cap = 0;
+	valenter(v);
+	return v;
+}
+
+/*
+   Return a referenced Value for a list. Leading cells are copied into
+   malloc space until a cell is reached which begins a stored value;
+   that value is then shared rather than copied.
+*/
+
+extern Value *listval(List *s) {
+	List *top, **end;
+	Value *share;
+	int own, nel;
+	if (s == NULL)
+		return NULL;
+	if ((share = valfind(s)) != NULL) {
+		share->refs++;
+		return share;
+	}
+	top = NULL;
+	end = &top;
+	for (own = 0; s != NULL && (share = valfind(s)) == NULL; s = s->n, own++) {
+		*end = enew(List);
+		(*end)->w = ecpy(s->w);
+		(*end)->m = NULL;
+		end = &(*end)->n;
+	}
+	*end = s;
+	nel = own;
+	if (share != NULL) {
+		share->refs++;
+		nel += share->nel;
+	}
+	return valnew(top, nel, own, share);
+}
+
+/* Make a Value of a list which is already in malloc space (e.g., from parse_var()). */
+
+extern Value *listown(List *s) {
+	int nel = listnel(s);
+	return (s == NULL) ? NULL : valnew(s, nel, nel, NULL);
+}
+
+/* Release a reference to a Value, freeing it when the last one goes. */
+
+/* free the table, once every Value is gone */
+
+extern void freevals() {
+	efree(vtab);
+	vtab = NULL;
+	vtsize = vtused = 0;
+}
+
+extern void valfree(Value *v) {
+	while (v != NULL && --v->refs == 0) {
+		Value *share = v->share;
+		List *l = v->def;
+		int i;
+		valremove(v);
+		for (i = 0; i < v->own; i++) {
+			List *n = l->n;
+			efree(l->w);
+			efree(l);
+			l = n;
+		}
+		efree(v);
+		v = share;
+	}
+}
@@ -9,16 +9,8 @@
 
 extern char **environ;
 
-bool dashdee, dashee, dasheye, dashell, dashen;
-bool dashpee, dashoh, dashess, dashvee, dashex;
-bool interactive;
 static bool dashEYE;
-char *dashsee[2];
-pid_t rc_pid;
-pid_t rc_ppid;
 
-
-static void assigndefault(char *,...);
 static void checkfd(int, enum redirtype);
 
 extern int main(int argc, char *argv[], char *envp[]) {
@@ -87,24 +79,7 @@ quitopts:
 	initsignal();
 	inithash();
 	initparse();
-	assigndefault("ifs", " ", "\t", "\n", (void *)0);
-	assigndefault("ofs", " ", (void *)0);
-	assigndefault("nl", "\n", (void *)0);
-#ifdef DEFAULTPATH
-	assigndefault("path", DEFAULTPATH, (void *)0);
-#endif
-	assigndefault("pid", nprint("%d", rc_pid), (void *)0);
-	assigndefault("ppid", nprint("%d", rc_ppid), (void *)0);
-	assigndefault("prompt", "; ", "", (void *)0);
-	assigndefault("tab", "\t", (void *)0);
-	assigndefault("version",
-		VERSION,
-		"$Release: @(#)" PACKAGE " " VERSION " " DESCRIPTION " $",
-		(void *)0 );
-	assigndefault("noexport",
-		"noexport", "apid", "apids", "bqstatus", "cdpath", "home",
-		"ifs", "ofs", "path", "pid", "ppid", "status", "*", (void *)0);
-	initenv(envp);
+	initvars(envp);
 	initinput();
 	null[0] = NULL;
 	starassign(dollarzero, null, FALSE); /* assign $0 to $* */
@@ -152,20 +127,6 @@ quitopts:
 	return 0; /* Never really reached. */
 }
 
-static void assigndefault(char *name,...) {
-	va_list ap;
-	List *l;
-	char *v;
-	va_start(ap, name);
-	for (l = NULL; (v = va_arg(ap, char *)) != NULL;)
-		l = append(l, word(v, NULL));
-	varassign(name, l, FALSE);
-	set_exportable(name, FALSE);
-	if (streq(name, "path"))
-		alias(name, l, FALSE);
-	va_end(ap);
-}
-
 /* open an fd on /dev/null if it is inherited closed */
 
 static void checkfd(int fd, enum redirtype r) {
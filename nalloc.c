@@ -1,12 +1,23 @@
 /* nalloc.c: a simple single-arena allocator for command-line-lifetime allocation */
 #include "rc.h"
 
+#include "interp.h"
+
 static struct Block {
 	size_t used, size;
 	char *mem;
 	Block *n;
 } *fl, *ul;
 
+static unsigned long arenabytes;	/* in blocks, used or free */
+static long heaplive;			/* ealloc()s not yet efree()d */
+
+/* heaplive counts for the whole process */
+const Region nallocglobals[] = {
+	REGION(ul), REGION(fl), REGION(arenabytes),
+	{ NULL, 0 }
+};
+
 /* alignto() works only with power of 2 blocks and assumes 2's complement arithmetic */
 #define alignto(m, n)   ((m + n - 1) & ~(n - 1))
 #define BLOCKSIZE ((size_t) 4096)
@@ -26,6 +37,7 @@ static void getblock(size_t n) {
 	} else {		/* else allocate a new block */
 		r = enew(Block);
 		r->mem = ealloc(r->size = alignto(n, BLOCKSIZE));
+		arenabytes += r->size;
 	}
 	r->used = 0;
 	r->n = ul;
@@ -82,6 +94,7 @@ extern void nfree() {
 			tmp->n = NULL;		/* terminate the free list */
 			while (r != NULL) {	/* free memory off the tail of the free list */
 				tmp = r->n;
+				arenabytes -= r->size;
 				efree(r->mem);
 				efree(r);
 				r = tmp;
@@ -109,6 +122,26 @@ extern void restoreblock(Block *old) {
 	ul = old;
 }
 
+/* Gives every block, used or free, back to the system. */
+
+extern void freeblocks() {
+	Block *r;
+	nfree();
+	while ((r = fl) != NULL) {
+		fl = r->n;
+		arenabytes -= r->size;
+		efree(r->mem);
+		efree(r);
+	}
+}
+
+/* for $rcstats */
+
+extern void memstats(unsigned long *arena, long *live) {
+	*arena = arenabytes;
+	*live = heaplive;
+}
+
 /* generic memory allocation functions */
 
 extern void *ealloc(size_t n) {
@@ -120,6 +153,7 @@ extern void *ealloc(size_t n) {
 		uerror("malloc");
 		rc_exit(1);
 	}
+	heaplive++;
 	return p;
 }
 
@@ -131,6 +165,7 @@ extern void *ecalloc(size_t nelem, size_t size) {
 		uerror("calloc");
 		rc_exit(1);
 	}
+	heaplive++;
 	return p;
 }
 
@@ -145,6 +180,8 @@ extern void *erealloc(void *p, size_t n) {
 }
 
 extern void efree(void *p) {
-	if (p != NULL)
+	if (p != NULL) {
+		heaplive--;
 		free(p);
+	}
 }
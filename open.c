@@ -1,7 +1,15 @@
 /* open.c: to insulate <fcntl.h> from the rest of rc. */
 
+#include "config.h"
+#if HAVE_MEMFD_CREATE
+#define _GNU_SOURCE /* for memfd_create() */
+#endif
+
 #include "rc.h"
 #include <fcntl.h>
+#if HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#endif
 
 /*
    Opens a file with the necessary flags. Assumes the following
@@ -24,6 +32,47 @@ extern int rc_open(const char *name, redirtype m) {
 	return open(name, mode_masks[m], 0666);
 }
 
+/*
+   Open a file for the redirection cache in redir.c: without blocking
+   (on a fifo, say), and moved out of the way of the fds a user is
+   likely to name, closed on exec. The fd itself is left blocking, as
+   the commands it is handed to expect. Truncation is left to the
+   caller.
+*/
+
+extern int rc_opencache(const char *name, redirtype m) {
+	int fd, hi;
+	if ((fd = open(name, (mode_masks[m] & ~O_TRUNC) | O_NONBLOCK, 0666)) < 0)
+		return -1;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	hi = fcntl(fd, F_DUPFD, 10);
+	close(fd);
+	if (hi >= 0)
+		fcntl(hi, F_SETFD, FD_CLOEXEC);
+	return hi;
+}
+
+/* open an anonymous, seekable file for reading and writing, in $TMPDIR if need be */
+
+extern int rc_tmpfd() {
+#if HAVE_MEMFD_CREATE
+	return memfd_create("rc", 0);
+#else
+	List *dir = varlookup("TMPDIR");
+	char *name;
+	int fd;
+
+	if (dir == NULL || *dir->w == '\0')
+		name = nprint("/tmp/rc.XXXXXX");
+	else
+		name = nprint("%s/rc.XXXXXX", dir->w);
+	fd = mkstemp(name);
+	if (fd >= 0)
+		unlink(name);
+	return fd;
+#endif
+}
+
 /* make a file descriptor blocking. return value indicates whether
 the descriptor was previously set to non-blocking. */
 
@@ -8,12 +8,19 @@
 /* note that this actually needs to appear before any system header
    files are included; byacc likes to throw in <stdlib.h> first. */
 #include "rc.h"
+#include "interp.h"
 
 static Node *star, *nolist;
 Node *parsetree;	/* not using yylval because bison declares it as an auto */
+
+/* star and nolist are made once, by initparse(), for every interpreter */
+const Region parseglobals[] = {
+	REGION(parsetree),
+	{ NULL, 0 }
+};
 %}
 
-%token ANDAND BACKBACK BANG CASE COUNT DUP ELSE END FLAT FN FOR IF IN NOT
+%token ANDAND BACKBACK BANG CASE COUNT DUP ELSE END FLAT FN FOR FUTURE IF IN NOT
 %token OROR PIPE REDIR SREDIR SUB SUBSHELL SWITCH TWIDDLE WHILE WORD HUH
 
 %left NOT
@@ -152,6 +159,7 @@ comword	: '$' sword			{ $$ = mk(nVar,$2); }
 	| '`' brace			{ $$ = mk(nBackq,nolist,$2); }
 	| BACKBACK word	brace		{ $$ = mk(nBackq,$2,$3); }
 	| BACKBACK word	sword		{ $$ = mk(nBackq,$2,$3); }
+	| FUTURE brace			{ $$ = mk(nFuture,nolist,$2); }
 	| '(' nlwords ')'		{ $$ = $2; }
 	| REDIR brace			{ $$ = mk(nNmpipe,$1.type,$1.fd,$2); }
 	| WORD				{ $$ = mk(nWord, $1.w, $1.m, $1.q); }
@@ -0,0 +1,31 @@
+/* probe.h: static tracepoints, for perf, bpftrace and the like */
+
+/*
+   Where the system has <sys/sdt.h> (from SystemTap), RC_PROBEn(name,
+   ...) marks a USDT probe rc:name, with n arguments; a double
+   underscore in name reads as a dash. A probe nobody is tracing costs
+   a nop. Elsewhere the probes, arguments and all, compile to nothing.
+
+	rc:fork (pid)			after rc forks, in the parent
+	rc:exec (path)			before rc_execve()
+	rc:wait (pid, status)		a child has been reaped
+	rc:glob-start (word)		the first word of a list to be globbed
+	rc:glob-done (word)
+	rc:backq-start (pid)		`{} has started its command
+	rc:backq-done (pid, status)
+	rc:function-entry (name)
+	rc:function-return (name)
+	rc:parse-start ()		rc is about to read a command
+	rc:parse-done (parsetree)
+*/
+
+#if HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define RC_PROBE0(name) DTRACE_PROBE(rc, name)
+#define RC_PROBE1(name, a) DTRACE_PROBE1(rc, name, a)
+#define RC_PROBE2(name, a, b) DTRACE_PROBE2(rc, name, a, b)
+#else
+#define RC_PROBE0(name)
+#define RC_PROBE1(name, a)
+#define RC_PROBE2(name, a, b)
+#endif
@@ -0,0 +1,156 @@
+/* prompt.c: running fn prompt before each command, or not */
+
+#include "rc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+
+#include "interp.h"
+#include "wait.h"
+
+/*
+   If $promptcache is set, fn prompt is not run before every prompt.
+   Its words name the variables the prompt depends on (say, cwd and
+   status), and may include a number of seconds: fn prompt is run
+   again only when one of those variables has changed since it last
+   ran, when that many seconds have passed, or when fn prompt itself
+   has been redefined. With neither, it is run every time. If the word
+   async appears too, a stale prompt is shown as it is, while fn prompt
+   runs in a child; the $prompt that child ends up with is taken up at
+   the first prompt after it has finished.
+*/
+
+static char *lastkey = NULL;	/* what fn prompt last depended on */
+static time_t lastrun;
+static pid_t pending = -1;	/* an asynchronous fn prompt */
+static int pendout, penddone;
+static bool died = FALSE;	/* fn prompt is running, or failed */
+
+const Region promptglobals[] = {
+	REGION(lastkey), REGION(lastrun), REGION(pending), REGION(pendout),
+	REGION(penddone), REGION(died),
+	{ NULL, 0 }
+};
+
+static char *arglist[] = { "prompt", NULL };
+
+static void call(void) {
+	if (!died) {
+		died = TRUE;
+		funcall(arglist);
+	}
+	died = FALSE;
+}
+
+/* take up the $prompt of an asynchronous fn prompt, if it is done */
+
+static void takeup(void) {
+	struct pollfd p;
+	List *val;
+	char *buf;
+	off_t len;
+	int sp;
+
+	if (pending < 0)
+		return;
+	p.fd = penddone;
+	p.events = POLLIN;
+	if (poll(&p, 1, 0) <= 0)
+		return;
+	len = lseek(pendout, 0, SEEK_END);
+	buf = nalloc(len + 1);
+	if (len > 0 && pread(pendout, buf, len, 0) == len) {
+		buf[len] = '\0';
+		if (strncmp(buf, "prompt=", 7) == 0) {
+			val = parse_var(buf);
+			assign(word("prompt", NULL), val, FALSE);
+			listfree(val);
+		}
+	}
+	close(pendout);
+	close(penddone);
+	rc_wait4(pending, &sp, TRUE);
+	pending = -1;
+}
+
+/* start fn prompt in a child, which leaves its $prompt in a file */
+
+static bool begin(void) {
+	int out, p[2];
+	pid_t pid;
+	char *s;
+
+	if ((out = rc_tmpfd()) < 0)
+		return FALSE;
+	if (pipe(p) < 0) {
+		close(out);
+		return FALSE;
+	}
+	if ((pid = rc_fork()) == 0) {
+		setsigdefaults(TRUE);
+		mvfd(rc_open("/dev/null", rFrom), 0);
+		mvfd(rc_open("/dev/null", rCreate), 1);
+		close(p[0]);
+		fcntl(p[1], F_SETFD, FD_CLOEXEC);
+		redirq = NULL;
+		funcall(arglist);
+		s = unparse_var("prompt", varlookup("prompt"));
+		writeall(out, s, strlen(s));
+		childexit(getstatus());
+	}
+	close(p[1]);
+	ownchild(pid, TRUE);
+	pending = pid;
+	pendout = highfd(out);
+	penddone = highfd(p[0]);
+	return TRUE;
+}
+
+/* forget what fn prompt depended on, and any asynchronous one */
+
+extern void forgetprompt() {
+	efree(lastkey);
+	lastkey = NULL;
+	if (pending >= 0) {
+		close(pendout);
+		close(penddone);
+		pending = -1;
+	}
+}
+
+extern void runprompt(void) {
+	List *deps, *s;
+	char *key;
+	bool async = FALSE, named = FALSE, first;
+	int ttl = -1, n;
+	time_t now;
+
+	if ((deps = varlookup("promptcache")) == NULL) {
+		call();
+		return;
+	}
+	takeup();
+	key = fnlookup_string("prompt");
+	for (s = deps; s != NULL; s = s->n)
+		if (streq(s->w, "async"))
+			async = TRUE;
+		else if ((n = a2u(s->w)) >= 0)
+			ttl = n;
+		else {
+			key = nprint("%s\001%s=%-L", key, s->w, varlookup(s->w), "\001");
+			named = TRUE;
+		}
+	now = time(NULL);
+	if (lastkey != NULL && streq(key, lastkey) && (ttl >= 0 ? now - lastrun < ttl : named))
+		return;
+	if (async && pending >= 0)
+		return; /* it is being brought up to date already */
+	first = lastkey == NULL;
+	efree(lastkey);
+	lastkey = ecpy(key);
+	lastrun = now;
+	if (!async || first || !begin())
+		call();
+}
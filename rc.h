@@ -31,6 +31,7 @@ typedef struct Node Node;
 typedef struct Pipe Pipe;
 typedef struct Redir Redir;
 typedef struct Rq Rq;
+typedef struct Value Value;
 typedef struct Variable Variable;
 typedef struct Word Word;
 typedef struct Format Format;
@@ -40,11 +41,13 @@ typedef enum nodetype {
 	nAndalso, nAssign, nBackq, nBang, nBody, nCbody, nNowait, nBrace,
 	nConcat, nCount, nElse, nFlat, nDup, nEpilog, nNewfn, nForin, nIf,
 	nIfnot, nOrelse, nPipe, nPre, nRedir, nRmfn, nArgs, nSubshell, nCase,
-	nSwitch, nMatch, nVar, nVarsub, nWhile, nWord, nLappend, nNmpipe
+	nSwitch, nMatch, nVar, nVarsub, nWhile, nWord, nLappend, nNmpipe,
+	nFuture
 } nodetype;
 
 typedef enum ecodes {
-	eError, eBreak, eReturn, eVarstack, eArena, eFifo, eFd, eContinue
+	eError, eBreak, eReturn, eVarstack, eArena, eFifo, eFd, eContinue,
+	eValue
 } ecodes;
 
 typedef enum bool {
@@ -62,6 +65,7 @@ union Edata {
 	Block *b;
 	char *name;
 	int fd;
+	Value *val;
 };
 
 struct Estack {
@@ -114,8 +118,19 @@ struct rc_Function {
 	char *extdef;
 };
 
-struct Variable {
+struct Value {
+	int refs;	/* variables, $* stacks and loops holding this value */
+	int nel;	/* number of elements */
+	int own;	/* number of leading cells which belong to this value */
+	Value *share;	/* the value which the rest of the cells belong to */
 	List *def;
+	List *last;	/* the last cell, or NULL if not yet known */
+	size_t len, cap; /* length and size of a one-word value grown by varconcat(), or 0 */
+	Value *link;	/* hash chain of live values; see list.c */
+};
+
+struct Variable {
+	Value *val;
 	char *extdef;
 	Variable *n;
 };
@@ -172,18 +187,21 @@ enum {
 
 /* rc prototypes */
 
-/* main.c */
+/* init.c */
 extern Rq *redirq;
 extern bool dashdee, dashee, dasheye, dashell, dashen;
 extern bool dashpee, dashoh, dashess, dashvee, dashex;
-extern bool interactive;
+extern bool interactive, embedded;
 extern char *dashsee[];
-extern pid_t rc_pid;
+extern pid_t rc_pid, rc_ppid;
 extern int lineno;
+extern void initvars(char **);
 
 /* builtins.c */
 extern builtin_t *isbuiltin(char *);
+extern bool writeonly(builtin_t *);
 extern void b_exec(char **), funcall(char **), b_dot(char **), b_builtin(char **);
+extern void funcall_list(char **, List *);
 extern char *compl_builtin(const char *, int);
 
 /* except.c */
@@ -195,6 +213,7 @@ extern void except(ecodes, Edata, Estack *);
 extern void unexcept(ecodes);
 extern void rc_error(char *) __dead;
 extern void sigint(int);
+extern int fndepth(void);
 
 /* exec.c */
 extern void exec(List *, bool);
@@ -208,9 +227,18 @@ extern int rc_execve(char *, char **, char **);
 extern char **list2array(List *, bool);
 extern char *get_name(char *);
 extern List *parse_var(char *);
+extern char *unparse_var(char *, List *);
 extern Node *parse_fn(char *);
 extern void initprint(void);
 extern void rc_exit(int) __dead; /* here for odd reasons; user-defined signal handlers are kept in fn.c */
+extern void childexit(int) __dead;
+
+/* future.c */
+extern void future(List *, Node *);
+extern void await(char *);
+extern void dropfuture(char *);
+extern void dropfutures(void);
+extern int highfd(int);
 
 /* getopt.c */
 extern int rc_getopt(int, char **, char *);
@@ -222,8 +250,14 @@ extern char *rc_optarg;
 extern bool lmatch(List *, List *);
 extern List *glob(List *);
 
+extern void globstats(unsigned long *, unsigned long *, int *);
+extern void forgetdirs(void);
+
 /* glom.c */
 extern void assign(List *, List *, bool);
+extern bool selfassign(Node *, Node *);
+extern void checkvarname(List *);
+extern List *bqinput(List *, int);
 extern void qredir(Node *);
 extern List *append(List *, List*);
 extern List *flatten(List *);
@@ -237,19 +271,26 @@ extern Htab *fp, *vp, *cp;
 extern void *lookup(char *, Htab *);
 extern rc_Function *get_fn_place(char *);
 extern List *varlookup(char *);
+extern int varnel(char *);
 extern Node *fnlookup(char *);
 extern Variable *get_var_place(char *, bool);
 extern bool varassign_string(char *);
 extern void set_cmd_path(char *, char *);
+extern void set_env_dirty(void);
 extern char **makeenv(void);
 extern char *fnlookup_string(char *);
 extern char *varlookup_string(char *);
 extern void alias(char *, List *, bool);
 extern void starassign(char *, char **, bool);
+extern bool starshift(int);
+extern bool varappend(char *, List *, List *);
+extern bool varconcat(char *, List *, char *);
 extern void delete_fn(char *);
 extern void delete_var(char *, bool);
 extern void delete_cmd(char *);
 extern void reset_cmdtab(void);
+extern void clearhash(void);
+extern void freehash(void);
 extern void fnassign(char *, Node *);
 extern void fnassign_string(char *);
 extern void fnrm(char *);
@@ -263,6 +304,7 @@ extern void varrm(char *, bool);
 extern void whatare_all_vars(bool, bool);
 extern void whatare_all_signals(void);
 extern void prettyprint_var(int, char *, List *);
+extern char *prettyvar(char *, List *);
 extern void prettyprint_fn(int, char *, Node *);
 extern char *compl_name(const char *, int, char **, size_t, ssize_t);
 extern char *compl_fn(const char *, int);
@@ -273,10 +315,16 @@ extern int heredoc(int);
 extern int qdoc(Node *, Node *);
 extern Hq *hq;
 
+/* jobserver.c */
+extern int jobtake(void);
+extern int jobpipe(void);
+extern void jobgive(int);
+
 /* lex.c */
 extern bool quotep(char *, bool);
 extern int yylex(void);
 extern void inityy(void);
+extern void freelex(void);
 extern void yyerror(const char *);
 extern void scanerror(char *);
 extern const char nw[], dnw[];
@@ -286,6 +334,11 @@ extern void listfree(List *);
 extern List *listcpy(List *, void *(*)(size_t));
 extern size_t listlen(List *);
 extern int listnel(List *);
+extern Value *listval(List *);
+extern Value *listown(List *);
+extern Value *valfind(List *);
+extern void valfree(Value *);
+extern void freevals(void);
 
 /* match.c */
 extern bool match(char *, char *, char *);
@@ -295,13 +348,17 @@ extern void *ealloc(size_t);
 extern void *ecalloc(size_t, size_t);
 extern void *erealloc(void *, size_t);
 extern void efree(void *);
+extern void memstats(unsigned long *, long *);
 extern Block *newblock(void);
 extern void *nalloc(size_t);
 extern void nfree(void);
 extern void restoreblock(Block *);
+extern void freeblocks(void);
 
 /* open.c */
 extern int rc_open(const char *, redirtype);
+extern int rc_opencache(const char *, redirtype);
+extern int rc_tmpfd(void);
 extern bool makeblocking(int);
 extern bool makesamepgrp(int);
 
@@ -335,26 +392,41 @@ extern Node *parsetree;
 extern int yyparse(void);
 extern void initparse(void);
 
+/* prompt.c */
+extern void runprompt(void);
+extern void forgetprompt(void);
+
 /* readline */
 extern volatile sig_atomic_t rl_active;
 extern struct Jbwrap rl_buf;
 
 /* redir.c */
-extern void doredirs(void);
+extern void doredirs(bool);
+extern bool prefetchredirs(void);
+extern void flushredirs(void);
+extern void forkredirs(bool);
+extern void dropexecs(void);
+extern void redirstats(unsigned long *, unsigned long *);
 
 
 /* signal.c */
 extern void initsignal(void);
 extern void catcher(int);
+extern int hookedsignals(int *);
 extern void sigchk(void);
 extern void (*rc_signal(int, void (*)(int)))(int);
 extern void (*sys_signal(int, void (*)(int)))(int);
 extern void (*sighandlers[])(int);
+extern void syncsignals(void);
 
 
+/* stats.c */
+extern List *sgetstats(void);
+
 /* status.c */
 extern int istrue(void);
 extern int getstatus(void);
+extern int getrawstatus(void);
 extern void set(bool);
 extern void setstatus(pid_t, int);
 extern List *sgetstatus(void);
@@ -380,6 +452,18 @@ extern volatile sig_atomic_t slow;
 #endif /* HAVE_RESTARTABLE_SYSCALLS */
 
 
+/* trace.c */
+extern void traceflush(void);
+extern void tracechange(void);
+extern void traceclose(void);
+extern void tracecmd(List *);
+extern void tracevar(char *, List *);
+extern void tracefn(char *, Node *);
+extern void tracematch(List *, List *);
+extern void tracetree(Node *);
+extern long slowstart(void);
+extern void slowend(long, Node *);
+
 /* tree.c */
 extern Node *mk(enum nodetype, ...);
 extern Node *treecpy(Node *, void *(*)(size_t));
@@ -388,6 +472,7 @@ extern void treefree(Node *);
 /* utils.c */
 extern bool isabsolute(char *);
 extern int n2u(char *, unsigned int);
+extern char *numword(int);
 extern int mvfd(int, int);
 extern int starstrcmp(const void *, const void *);
 extern void pr_error(char *, int);
@@ -396,9 +481,14 @@ extern void uerror(char *);
 
 /* wait.c */
 extern pid_t rc_fork(void);
+extern pid_t rc_forkjob(void);
+extern void ownchild(pid_t, bool);
+extern void forkstats(unsigned long *);
 extern pid_t rc_wait4(pid_t, int *, bool);
+extern void giveslots(void);
 extern List *sgetapids(void);
 extern void waitforall(void);
+extern int rc_poll(int *, bool *, int, pid_t *, int, long, bool *);
 extern bool forked;
 
 /* walk.c */
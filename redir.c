@@ -2,6 +2,229 @@
 
 #include "rc.h"
 
+#include <errno.h>
+#include <unistd.h>
+
+#include "interp.h"
+
+/*
+   Files named by >> are kept open by the shell until the end of the
+   command line, so that a loop like
+	for (i in $list) echo $i >>log
+   opens log just once. Before forking, rc opens (or finds in the cache)
+   each regular file whose name it can compute without side effects, and
+   the child dup2()s the cached fd into place. Only the >> redirections
+   at the head of the queue are prefetched, so a file is never created
+   before an earlier redirection which might fail. > is not cached: two
+   commands would share one file offset, and truncating it for the
+   second would move the first's if it were still running.
+   An entry is reused only while the name still refers to the same
+   device and inode, and never for an executable file.
+*/
+
+#define NFCACHE 8
+
+struct Fcache {
+	char *name;
+	redirtype mode;
+	int fd;
+	dev_t dev;
+	ino_t ino;
+	unsigned long used;
+	bool fresh;	/* checked for the command about to be forked */
+};
+
+static struct Fcache fcache[NFCACHE];
+static int nfcache;
+static unsigned long fcclock, fchits, fcmisses;
+
+const Region redirglobals[] = {
+	REGION(fcache), REGION(nfcache), REGION(fcclock), REGION(fchits),
+	REGION(fcmisses),
+	{ NULL, 0 }
+};
+
+static struct Fcache *fclookup(char *name, redirtype mode) {
+	int i;
+	for (i = 0; i < nfcache; i++)
+		if (fcache[i].mode == mode && streq(fcache[i].name, name))
+			return &fcache[i];
+	return NULL;
+}
+
+/* remove an entry, leaving its fd alone */
+
+static void fcunlink(struct Fcache *c) {
+	efree(c->name);
+	*c = fcache[--nfcache];
+}
+
+static void fcdrop(struct Fcache *c) {
+	close(c->fd);
+	fcunlink(c);
+}
+
+extern void flushredirs() {
+	while (nfcache > 0)
+		fcdrop(&fcache[0]);
+}
+
+extern void redirstats(unsigned long *hits, unsigned long *misses) {
+	*hits = fchits;
+	*misses = fcmisses;
+}
+
+/*
+   A file open for writing cannot be executed (ETXTBSY), so before rc
+   runs a program, it forgets files which have been made executable.
+*/
+
+extern void dropexecs() {
+	struct stat s;
+	int i;
+	for (i = 0; i < nfcache;)
+		if (fstat(fcache[i].fd, &s) < 0 || s.st_dev != fcache[i].dev || s.st_ino != fcache[i].ino)
+			fcunlink(&fcache[i]);
+		else if ((s.st_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) != 0)
+			fcdrop(&fcache[i]);
+		else
+			i++;
+}
+
+/* can this filename be computed without side effects or errors? */
+
+static bool plainname(Node *n) {
+	Node *v;
+	if (n == NULL)
+		return FALSE;
+	switch (n->type) {
+	default:
+		return FALSE;
+	case nWord:
+		return n->u[1].s == NULL; /* no globbing */
+	case nConcat: /* of single words, which never fails */
+		return plainname(n->u[0].p) && plainname(n->u[1].p);
+	case nFlat:
+	case nVar:
+		v = n->u[0].p;
+		return v->type == nWord && *v->u[0].s != '\0' && !streq(v->u[0].s, "*")
+			&& (n->type == nFlat || varnel(v->u[0].s) <= 1);
+	}
+}
+
+static bool fcopen(char *name, redirtype mode) {
+	struct Fcache *c;
+	struct stat s;
+	int i, fd;
+
+	if ((c = fclookup(name, mode)) != NULL) {
+		if (fstat(c->fd, &s) < 0 || s.st_dev != c->dev || s.st_ino != c->ino)
+			fcunlink(c); /* the fd has been put to another use */
+		else if (stat(name, &s) == 0 && s.st_dev == c->dev && s.st_ino == c->ino
+		    && (s.st_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) == 0) {
+			fchits++;
+			c->used = ++fcclock;
+			c->fresh = TRUE;
+			return TRUE;
+		} else
+			fcdrop(c);
+	}
+	if ((fd = rc_opencache(name, mode)) < 0)
+		return FALSE;
+	if (fstat(fd, &s) < 0 || !S_ISREG(s.st_mode) || (s.st_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) != 0) {
+		close(fd);
+		return FALSE;
+	}
+	fcmisses++;
+	if (nfcache == NFCACHE) { /* evict the least recently used */
+		for (c = &fcache[0], i = 1; i < nfcache; i++)
+			if (fcache[i].used < c->used)
+				c = &fcache[i];
+		fcdrop(c);
+	}
+	c = &fcache[nfcache++];
+	c->name = ecpy(name);
+	c->mode = mode;
+	c->fd = fd;
+	c->dev = s.st_dev;
+	c->ino = s.st_ino;
+	c->used = ++fcclock;
+	c->fresh = TRUE;
+	return TRUE;
+}
+
+/* open the files for the redirections of a command that is about to fork */
+
+extern bool prefetchredirs() {
+	List *fname;
+	Rq *r;
+	int i;
+	bool any = FALSE;
+	for (i = 0; i < nfcache; i++)
+		fcache[i].fresh = FALSE;
+	for (r = redirq; r != NULL; r = r->n) {
+		if (r->r->type != nRedir || r->r->u[0].i != rAppend || !plainname(r->r->u[2].p)
+		    || (fname = glom(r->r->u[2].p)) == NULL || fname->n != NULL
+		    || !fcopen(fname->w, rAppend))
+			break;
+		any = TRUE;
+	}
+	return any;
+}
+
+/*
+   Only the command prefetchredirs() was called for may see the cached
+   fds; any other child closes them, as a child of rc_fork() which has
+   no use for them.
+*/
+
+extern void forkredirs(bool child) {
+	int i;
+	for (i = 0; i < nfcache;)
+		if (child && !fcache[i].fresh)
+			fcdrop(&fcache[i]);
+		else {
+			if (!child)
+				fcache[i].fresh = FALSE;
+			i++;
+		}
+}
+
+/* the cached fd for a redirection, or -1 */
+
+static int fcget(char *name, redirtype mode) {
+	struct Fcache *c = fclookup(name, mode);
+	if (c == NULL || !c->fresh)
+		return -1;
+	return c->fd;
+}
+
+/*
+   A redirection onto fd replaces any cached fd of that number: the fd
+   is no longer the cache's to use or to close.
+*/
+
+static void fcforget(int fd) {
+	int i;
+	for (i = 0; i < nfcache; i++)
+		if (fcache[i].fd == fd) {
+			fcunlink(&fcache[i]);
+			return;
+		}
+}
+
+/* is fd one of the cache's, which the user never opened? */
+
+static bool fcheld(int fd) {
+	int i;
+	for (i = 0; i < nfcache; i++)
+		if (fcache[i].fd == fd) {
+			errno = EBADF;
+			return TRUE;
+		}
+	return FALSE;
+}
+
 /*
    Walk the redirection queue, and open files and dup2 to them. Also,
    here-documents are treated here by dumping them down a pipe. (this
@@ -11,13 +234,17 @@
    shar runs when unpacking when invoked with rc instead of sh. On my
    sun4/280, it runs in about 60-75% of the time of sh for unpacking
    the rc source distribution.)
+
+   prefetched is true in a child whose parent has just called
+   prefetchredirs().
 */
 
-extern void doredirs() {
+extern void doredirs(bool prefetched) {
 	List *fname;
 	int fd, p[2];
 	Rq *r;
 	for (r = redirq; r != NULL; r = r->n) {
+		fcforget(r->r->u[1].i);
 		switch(r->r->type) {
 		default:
 			panic("unexpected node in doredirs");
@@ -34,7 +261,7 @@ extern void doredirs() {
 					close(p[0]);
 					if (fname != NULL)
 						writeall(p[1], fname->w, strlen(fname->w));
-					exit(0);
+					childexit(0);
 				} else {
 					close(p[1]);
 					if (mvfd(p[0], r->r->u[1].i) < 0)
@@ -50,7 +277,16 @@ extern void doredirs() {
 				default:
 					panic("unexpected node in doredirs");
 					/* NOTREACHED */
-				case rCreate: case rAppend: case rFrom:
+				case rCreate: case rAppend:
+					if (prefetched && (fd = fcget(fname->w, r->r->u[0].i)) >= 0) {
+						if (dup2(fd, r->r->u[1].i) < 0) {
+							uerror("dup2");
+							rc_error(NULL);
+						}
+						continue;
+					}
+					/* FALLTHROUGH */
+				case rFrom:
 					fd = rc_open(fname->w, r->r->u[0].i);
 					break;
 				}
@@ -66,12 +302,14 @@ extern void doredirs() {
 			if (r->r->u[2].i == -1)
 				close(r->r->u[1].i);
 			else if (r->r->u[2].i != r->r->u[1].i) {
-				if (dup2(r->r->u[2].i, r->r->u[1].i) < 0) {
+				if (fcheld(r->r->u[2].i) || dup2(r->r->u[2].i, r->r->u[1].i) < 0) {
 					uerror("dup2");
 					rc_error(NULL);
 				}
 			}
 		}
 	}
+	if (prefetched)
+		flushredirs(); /* the command itself never sees them */
 	redirq = NULL;
 }
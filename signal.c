@@ -5,19 +5,34 @@
 #include <signal.h>
 #include <setjmp.h>
 
+#include "interp.h"
 #include "sigmsgs.h"
 #include "jbwrap.h"
 
 #if HAVE_SIGACTION
+#if HAVE_RESTARTABLE_SYSCALLS
+static void slowcatcher(int, siginfo_t *, void *);
+#endif
+
 void (*sys_signal(int signum, void (*handler)(int)))(int) {
 	struct sigaction new, old;
 
 	new.sa_handler = handler;
 	new.sa_flags = 0; /* clear SA_RESTART */
+#if HAVE_RESTARTABLE_SYSCALLS
+	if (handler == catcher) {
+		new.sa_sigaction = slowcatcher;
+		new.sa_flags = SA_SIGINFO;
+	}
+#endif
 	sigfillset(&new.sa_mask);
-	if (sigaction(signum, &new, &old) == 0)
-		return old.sa_handler;
-	return SIG_DFL;
+	if (sigaction(signum, &new, &old) != 0)
+		return SIG_DFL;
+#if HAVE_RESTARTABLE_SYSCALLS
+	if ((old.sa_flags & SA_SIGINFO) && old.sa_sigaction == slowcatcher)
+		return catcher;
+#endif
+	return old.sa_handler;
 }
 #else
 void (*sys_signal(int signum, void (*handler)(int)))(int) {
@@ -29,6 +44,34 @@ void (*sighandlers[NUMOFSIGNALS])(int);
 
 static volatile sig_atomic_t sigcount, caught[NUMOFSIGNALS];
 
+/* the signals which have a handler of rc's own, for setsigdefaults() */
+static int hooked[NUMOFSIGNALS], nhooked;
+
+/*
+   The disposition each signal should have while this interpreter runs,
+   and the one it has in the process; syncsignals() makes them agree
+   after librc changes interpreters.
+*/
+static void (*wanted[NUMOFSIGNALS])(int), (*installed[NUMOFSIGNALS])(int);
+
+const Region signalglobals[] = {
+	REGION(sighandlers), REGION(hooked), REGION(nhooked), REGION(wanted),
+	{ (void *) caught, sizeof caught }, { (void *) &sigcount, sizeof sigcount },
+	{ NULL, 0 }
+};
+
+static void setsig(int s, void (*h)(int)) {
+	wanted[s] = installed[s] = h;
+	sys_signal(s, h);
+}
+
+extern void syncsignals() {
+	int i;
+	for (i = 1; i < NUMOFSIGNALS; i++)
+		if (wanted[i] != installed[i])
+			setsig(i, wanted[i]);
+}
+
 extern void catcher(int s) {
 	if (caught[s] == 0) {
 		sigcount++;
@@ -36,13 +79,30 @@ extern void catcher(int s) {
 	}
 	sys_signal(s, catcher);
 
-#if HAVE_RESTARTABLE_SYSCALLS
+#if HAVE_RESTARTABLE_SYSCALLS && !HAVE_SIGACTION
 	if (slow) {
 		siglongjmp(slowbuf.j, s);
 	}
 #endif
 }
 
+#if HAVE_RESTARTABLE_SYSCALLS && HAVE_SIGACTION
+/*
+   The slow system call wrappers in system.c do not save the signal
+   mask, which would take a system call each time. Instead, before
+   jumping out of a call, the catcher puts back the mask of the code it
+   interrupted, which the kernel has kept in the context.
+*/
+
+static void slowcatcher(int s, siginfo_t *info, void *context) {
+	catcher(s);
+	if (slow) {
+		sigprocmask(SIG_SETMASK, &((ucontext_t *) context)->uc_sigmask, NULL);
+		siglongjmp(slowbuf.j, s);
+	}
+}
+#endif
+
 extern void sigchk() {
 	void (*h)(int);
 	int s, i;
@@ -50,7 +110,7 @@ extern void sigchk() {
 	if (sigcount == 0)
 		return; /* ho hum; life as usual */
 	if (forked)
-		exit(1); /* exit unconditionally on a signal in a child process */
+		childexit(1); /* exit unconditionally on a signal in a child process */
 	for (i = 0, s = -1; i < NUMOFSIGNALS; i++)
 		if (caught[i] != 0) {
 			s = i;
@@ -73,12 +133,28 @@ extern void (*rc_signal(int s, void (*h)(int)))(int) {
 	old = sighandlers[s];
 	sighandlers[s] = h;
 	if (h == SIG_DFL || h == SIG_IGN)
-		sys_signal(s, h);
+		setsig(s, h);
 	else
-		sys_signal(s, catcher);
+		setsig(s, catcher);
+	if ((old == SIG_DFL || old == SIG_IGN) != (h == SIG_DFL || h == SIG_IGN)) {
+		int i;
+		for (i = 0; i < nhooked && hooked[i] != s; i++)
+			;
+		if (i == nhooked)
+			hooked[nhooked++] = s;
+		else
+			hooked[i] = hooked[--nhooked];
+	}
 	return old;
 }
 
+/* copy the signals rc catches to sigs; returns how many */
+
+extern int hookedsignals(int *sigs) {
+	memcpy(sigs, hooked, nhooked * sizeof *sigs);
+	return nhooked;
+}
+
 extern void initsignal() {
 	void (*h)(int);
 	int i;
@@ -100,6 +176,8 @@ extern void initsignal() {
 		h = sys_signal(i, SIG_IGN);
 		if (h != SIG_IGN && h != SIG_ERR)
 			sys_signal(i, h);
-		sighandlers[i] = h;
+		sighandlers[i] = wanted[i] = installed[i] = h;
+		if (h != SIG_IGN && h != SIG_DFL && h != SIG_ERR) /* librc's caller's */
+			hooked[nhooked++] = i;
 	}
 }
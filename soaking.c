@@ -0,0 +1,101 @@
+/* This is an auxiliary test program for rc: "make soak" pipes its output to rc. */
+
+/*
+   Writes a long run of commands, one per line, so that rc runs each of
+   them from its main loop, on a fresh arena: variables set and deleted,
+   functions defined, called and deleted, globbing, backquotes, local
+   assignments, eval and pattern matching. Every tenth of the way, it
+   asks rc for its resident size and its $rcstats; the first sample is
+   the baseline, and rc exits 1 if a later one has grown by too much.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char preamble[] =
+"fn soakget {\n"
+"	soakval = ()\n"
+"	name = $1\n"
+"	* = $rcstats\n"
+"	while (!~ $#* 0) {\n"
+"		if (~ $1 $name)\n"
+"			soakval = $2\n"
+"		shift 2\n"
+"	}\n"
+"}\n"
+"fn soakfail {\n"
+"	echo soak: $* >[1=2]\n"
+"	exit 1\n"
+"}\n"
+"fn soakcheck {\n"
+"	rss = 0\n"
+"	if (test -r /proc/$pid/status)\n"
+"		rss = `{sed -n 's/^VmRSS:[^0-9]*\\([0-9]*\\).*/\\1/p' /proc/$pid/status}\n"
+"	soakget arenabytes; arena = $soakval\n"
+"	soakget heapallocs; heap = $soakval\n"
+"	echo soak: $1 commands, rss $rss kB, arena $arena bytes, $heap allocations\n"
+"	if (~ $#soakbase 0) {\n"
+"		soakbase = ($rss $arena $heap)\n"
+"	}\n"
+"	if not {\n"
+"		if (test $rss -gt `{expr $soakbase(1) + $soakbase(1) / 4 + 1024})\n"
+"			soakfail resident size grew from $soakbase(1) to $rss kB\n"
+"		if (test $arena -gt `{expr $soakbase(2) + 1048576})\n"
+"			soakfail arenas grew from $soakbase(2) to $arena bytes\n"
+"		if (test $heap -gt `{expr $soakbase(3) + 1000})\n"
+"			soakfail allocations grew from $soakbase(3) to $heap\n"
+"	}\n"
+"}\n";
+
+static void command(long i) {
+	long c = i / 10;
+
+	switch (i % 10) {
+	case 0:
+		printf("v%ld = (a b c %ld)\n", c % 1000, c);
+		break;
+	case 1:
+		printf("v%ld = ()\n", (c + 500) % 1000);
+		break;
+	case 2:
+		printf("fn f%ld { v = $*; w = $#* }\n", c % 100);
+		break;
+	case 3:
+		printf("f%ld x y `{echo %ld}\n", c % 100, c % 50 == 0 ? c : 0);
+		break;
+	case 4:
+		printf("fn f%ld\n", (c + 50) % 100);
+		break;
+	case 5:
+		printf("g = (/dev/nu* /dev/[z]ero*)\n");
+		break;
+	case 6:
+		if (c % 50 == 0)
+			printf("x = `{echo %ld}\n", c);
+		else
+			printf("x = (%ld $x(1 2))\n", c);
+		break;
+	case 7:
+		printf("a = %ld b = (x y) { c = $a^$b; d = $#c }\n", c);
+		break;
+	case 8:
+		printf("eval 'e%ld = (' %ld ')'; e%ld = ()\n", c % 10, c, c % 10);
+		break;
+	case 9:
+		printf("if (~ $v%ld(4) *[02468]) y = even; if not y = odd\n", c % 1000);
+		break;
+	}
+}
+
+int main(int argc, char **argv) {
+	long i, n = argc > 1 ? atol(argv[1]) : 1000000;
+
+	fputs(preamble, stdout);
+	for (i = 0; i < n; i++) {
+		command(i);
+		if ((i + 1) % (n / 10 > 0 ? n / 10 : 1) == 0)
+			printf("soakcheck %ld\n", i + 1);
+	}
+	puts("echo soak: ok");
+	return 0;
+}
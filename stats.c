@@ -0,0 +1,42 @@
+/* stats.c: rc's internal counters, as the value of $rcstats */
+
+#include "rc.h"
+
+/*
+   $rcstats is a list of names and values, in pairs:
+	globhits, globmisses	directory listings found in the glob
+				cache, and read afresh
+	globdirs		directories in the glob cache
+	redirhits, redirmisses	files for > and >> found open in the
+				redirection cache, and opened afresh
+	arenabytes		memory held for the per-command arenas
+	heapallocs		ealloc()s not yet freed
+	forks			calls of rc_fork()
+*/
+
+static List *pair(List *r, char *name, unsigned long value) {
+	r->n = word(name, NULL);
+	return r->n->n = word(nprint("%uld", value), NULL);
+}
+
+extern List *sgetstats() {
+	List top, *r = &top;
+	unsigned long hits, misses;
+	long live;
+	int dirs;
+
+	globstats(&hits, &misses, &dirs);
+	r = pair(r, "globhits", hits);
+	r = pair(r, "globmisses", misses);
+	r = pair(r, "globdirs", dirs);
+	redirstats(&hits, &misses);
+	r = pair(r, "redirhits", hits);
+	r = pair(r, "redirmisses", misses);
+	memstats(&hits, &live);
+	r = pair(r, "arenabytes", hits);
+	r->n = word("heapallocs", NULL);
+	r = r->n->n = word(nprint("%ld", live), NULL);
+	forkstats(&hits);
+	r = pair(r, "forks", hits);
+	return top.n;
+}
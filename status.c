@@ -1,6 +1,7 @@
 /* status.c: functions for printing fancy status messages in rc */
 
 #include "rc.h"
+#include "interp.h"
 #include "sigmsgs.h"
 #include "statval.h"
 #include "wait.h"
@@ -14,6 +15,11 @@ static void statprint(pid_t, int);
 static int statuses[512];
 static int pipelength = 1;
 
+const Region statusglobals[] = {
+	REGION(statuses), REGION(pipelength),
+	{ NULL, 0 }
+};
+
 /*
    Test to see if rc's status is true. According to td, status is true
    if and only if every pipe-member has an exit status of zero.
@@ -44,6 +50,14 @@ extern int getstatus() {
 	return WEXITSTATUS(s);
 }
 
+/* the status as a wait() value, for a pipeline stage run by rc itself */
+
+extern int getrawstatus() {
+	if (pipelength > 1)
+		return istrue() ? STATUS0 : STATUS1;
+	return statuses[0];
+}
+
 extern void set(bool code) {
 	setstatus(-1, code ? STATUS0 : STATUS1);
 }
@@ -156,7 +170,7 @@ extern char *strstatus(int s) {
 		else
 			return nprint("-%d%s", t, core); /* unknown signals are negated */
 	} else
-		return nprint("%d", WEXITSTATUS(s));
+		return numword(WEXITSTATUS(s));
 }
 
 extern void ssetstatus(char **av) {
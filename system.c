@@ -9,6 +9,13 @@
 Jbwrap slowbuf;
 volatile sig_atomic_t slow;
 
+/* with sigaction(), the catcher restores the signal mask itself */
+#if HAVE_SIGACTION
+#define SAVEMASK 0
+#else
+#define SAVEMASK 1
+#endif
+
 static char *safe_buf;
 static size_t safe_remain;
 
@@ -18,7 +25,7 @@ extern void writeall(int fd, char *buf, size_t remain) {
 	safe_buf = buf;
 	safe_remain = remain;
 	for (i = 0; safe_remain > 0; buf += i, safe_remain -= i) {
-		if (sigsetjmp(slowbuf.j, 1) == 0) {
+		if (sigsetjmp(slowbuf.j, SAVEMASK) == 0) {
 			slow = TRUE;
 			if ((i = write(fd, safe_buf, safe_remain)) <= 0)
 				break; /* abort silently on errors in write() */
@@ -32,7 +39,7 @@ extern void writeall(int fd, char *buf, size_t remain) {
 extern int rc_read(int fd, char *buf, size_t n) {
 	ssize_t r;
 
-	if (sigsetjmp(slowbuf.j, 1) == 0) {
+	if (sigsetjmp(slowbuf.j, SAVEMASK) == 0) {
 		slow = TRUE;
 		r = read(fd, buf, n);
 	} else {
@@ -46,7 +53,7 @@ extern int rc_read(int fd, char *buf, size_t n) {
 
 static int r = -1;
 extern pid_t rc_wait(int *stat) {
-	if (sigsetjmp(slowbuf.j, 1) == 0) {
+	if (sigsetjmp(slowbuf.j, SAVEMASK) == 0) {
 		slow = TRUE;
 		r = wait(stat);
 	} else {
@@ -0,0 +1,327 @@
+/* trace.c: output for rc -x */
+
+#include "rc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "interp.h"
+
+/*
+   Trace output goes to fd 2 a line at a time, as it always has, unless
+   $xtrace names another fd or a file. In that case it is collected in
+   a buffer which is written out when it fills, before rc forks or
+   execs, at exit, and before librc changes interpreters (which is why
+   they can share the buffer). $xtraceopts may contain "time" (prefix each line
+   with the time of day), "depth" (prefix each line with one "+" per
+   level of function or dot-script nesting) and "json" (write one JSON
+   object per line instead of rc syntax).
+*/
+
+enum { tTime = 1, tDepth = 2, tJson = 4 };
+
+static char tracebuf[8192];
+static Format tf;
+static int tracefd = 2;
+static bool ownfd = FALSE;	/* tracefd was opened from $xtrace */
+static bool buffered = FALSE;
+static bool stale = TRUE;	/* $xtrace or $xtraceopts changed */
+static int opts = 0;
+
+static int slowfd = -1;
+static bool slowown = FALSE;	/* slowfd was opened from $slowlog */
+static bool slowstale = TRUE;	/* $slowlog or $slowms changed */
+static long slowms;
+
+const Region traceglobals[] = {
+	REGION(tf), REGION(tracefd), REGION(ownfd),
+	REGION(buffered), REGION(stale), REGION(opts), REGION(slowfd),
+	REGION(slowown), REGION(slowstale), REGION(slowms),
+	{ NULL, 0 }
+};
+
+static void tracegrow(Format *f, size_t ignore) {
+	size_t n = f->buf - f->bufbegin;
+	f->buf = f->bufbegin;
+	if (n > 0)
+		writeall(tracefd, f->bufbegin, n);
+}
+
+extern void traceflush(void) {
+	if (tf.buf != tf.bufbegin)
+		tracegrow(&tf, 0);
+}
+
+extern void tracechange(void) {
+	stale = slowstale = TRUE;
+}
+
+/* flush the trace, and close files opened for $xtrace and $slowlog */
+
+extern void traceclose() {
+	traceflush();
+	if (ownfd)
+		close(tracefd);
+	if (slowown)
+		close(slowfd);
+	tracefd = 2;
+	slowfd = -1;
+	ownfd = slowown = buffered = FALSE;
+	stale = slowstale = TRUE;
+}
+
+static void traceinit(void) {
+	static bool registered = FALSE;
+	List *s;
+	int fd;
+
+	traceflush();
+	if (ownfd)
+		close(tracefd);
+	tracefd = 2;
+	ownfd = buffered = FALSE;
+	opts = 0;
+	stale = FALSE;
+	if ((s = varlookup("xtrace")) != NULL) {
+		if ((fd = a2u(s->w)) >= 0) {
+			tracefd = fd;
+		} else if ((fd = open(s->w, O_WRONLY|O_CREAT|O_APPEND, 0666)) >= 0) {
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+			tracefd = fd;
+			ownfd = TRUE;
+		} else {
+			fprint(2, RC "can't open %s: %s\n", s->w, strerror(errno));
+		}
+		buffered = TRUE;
+	}
+	for (s = varlookup("xtraceopts"); s != NULL; s = s->n)
+		if (streq(s->w, "time"))
+			opts |= tTime;
+		else if (streq(s->w, "depth"))
+			opts |= tDepth;
+		else if (streq(s->w, "json"))
+			opts |= tJson;
+	if (buffered && !registered) {
+		atexit(traceflush);
+		registered = TRUE;
+	}
+	tf.buf = tf.bufbegin = tracebuf;
+	tf.bufend = tracebuf + sizeof tracebuf;
+	tf.grow = tracegrow;
+	tf.flushed = 0;
+}
+
+static void tprint(const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	va_copy(tf.args, ap);
+	printfmt(&tf, fmt);
+	va_end(tf.args);
+	va_end(ap);
+}
+
+static void jsonstr(char *s) {
+	static const char hex[] = "0123456789abcdef";
+	int c;
+	fmtputc(&tf, '"');
+	for (; (c = *(unsigned char *) s) != '\0'; s++)
+		if (c == '"' || c == '\\') {
+			fmtputc(&tf, '\\');
+			fmtputc(&tf, c);
+		} else if (c < ' ') {
+			fmtcat(&tf, "\\u00");
+			fmtputc(&tf, hex[c >> 4]);
+			fmtputc(&tf, hex[c & 15]);
+		} else
+			fmtputc(&tf, c);
+	fmtputc(&tf, '"');
+}
+
+static void jsonlist(List *s) {
+	fmtputc(&tf, '[');
+	for (; s != NULL; s = s->n) {
+		jsonstr(s->w);
+		if (s->n != NULL)
+			fmtputc(&tf, ',');
+	}
+	fmtputc(&tf, ']');
+}
+
+static void tracebegin(char *event) {
+	struct timeval tv;
+	int depth = 0;
+
+	if (stale)
+		traceinit();
+	if (opts & tTime)
+		gettimeofday(&tv, NULL);
+	if (opts & tDepth)
+		depth = fndepth();
+	if (opts & tJson) {
+		tprint("{\"event\":\"%s\",\"pid\":%d", event, getpid());
+		if (opts & tTime)
+			tprint(",\"time\":%ld.%06ld", (long) tv.tv_sec, (long) tv.tv_usec);
+		if (opts & tDepth)
+			tprint(",\"depth\":%d", depth);
+		return;
+	}
+	if (opts & tTime)
+		tprint("%ld.%06ld ", (long) tv.tv_sec, (long) tv.tv_usec);
+	if (opts & tDepth) {
+		for (; depth >= 0; depth--)
+			fmtputc(&tf, '+');
+		fmtputc(&tf, ' ');
+	}
+}
+
+static void traceend(void) {
+	if (opts & tJson)
+		fmtputc(&tf, '}');
+	fmtputc(&tf, '\n');
+	if (!buffered)
+		traceflush();
+}
+
+/* a simple command, about to be run */
+
+extern void tracecmd(List *s) {
+	tracebegin("cmd");
+	if (opts & tJson) {
+		fmtcat(&tf, ",\"argv\":");
+		jsonlist(s);
+	} else
+		tprint("%L", s, " ");
+	traceend();
+}
+
+/* an assignment; s == NULL for deletion */
+
+extern void tracevar(char *name, List *s) {
+	char *p = NULL;
+	if (stale)
+		traceinit();
+	if (!(opts & tJson) && (p = prettyvar(name, s)) == NULL)
+		return;
+	tracebegin("assign");
+	if (opts & tJson) {
+		fmtcat(&tf, ",\"name\":");
+		jsonstr(name);
+		fmtcat(&tf, ",\"value\":");
+		jsonlist(s);
+	} else
+		fmtcat(&tf, p);
+	traceend();
+}
+
+/* a function definition; n == NULL for deletion */
+
+extern void tracefn(char *name, Node *n) {
+	tracebegin(n == NULL ? "fnrm" : "fn");
+	if (opts & tJson) {
+		fmtcat(&tf, ",\"name\":");
+		jsonstr(name);
+		if (n != NULL) {
+			fmtcat(&tf, ",\"body\":");
+			jsonstr(nprint("%T", n));
+		}
+	} else if (n == NULL)
+		tprint("fn %S", name);
+	else
+		tprint("fn %S {%T}", name, n);
+	traceend();
+}
+
+/* a ~ command */
+
+extern void tracematch(List *a, List *b) {
+	tracebegin("match");
+	if (opts & tJson) {
+		fmtcat(&tf, ",\"subject\":");
+		jsonlist(a);
+		fmtcat(&tf, ",\"patterns\":");
+		jsonlist(b);
+	} else
+		tprint((a != NULL && a->n != NULL) ? "~ (%L) %L" : "~ %L %L", a, " ", b, " ");
+	traceend();
+}
+
+/* a parse tree, for rc -nx */
+
+extern void tracetree(Node *n) {
+	tracebegin("tree");
+	if (opts & tJson) {
+		fmtcat(&tf, ",\"text\":");
+		jsonstr(nprint("%T", n));
+	} else
+		tprint("%T", n);
+	traceend();
+}
+
+/*
+   $slowlog names a file (or an fd) to which rc appends a line for each
+   simple command (function calls included) or pipeline that takes
+   $slowms milliseconds or longer (1000 if $slowms is unset): the time
+   it finished, how long it took, its status, rc's pid, the line of the
+   script, and the command itself. Commands are timed only while
+   $slowlog is set.
+*/
+
+static long msnow(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000L + t.tv_nsec / 1000000;
+}
+
+static void slowinit(void) {
+	List *s;
+	int fd;
+
+	if (slowown)
+		close(slowfd);
+	slowfd = -1;
+	slowown = slowstale = FALSE;
+	if ((s = varlookup("slowlog")) == NULL)
+		return;
+	if ((fd = a2u(s->w)) >= 0) {
+		slowfd = fd;
+	} else if ((fd = open(s->w, O_WRONLY|O_CREAT|O_APPEND, 0666)) >= 0) {
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		slowfd = fd;
+		slowown = TRUE;
+	} else {
+		fprint(2, RC "can't open %s: %s\n", s->w, strerror(errno));
+	}
+	s = varlookup("slowms");
+	if (s == NULL || (slowms = a2u(s->w)) < 0)
+		slowms = 1000;
+}
+
+/* the time a command starts, or -1 if it need not be timed */
+
+extern long slowstart(void) {
+	if (slowstale)
+		slowinit();
+	return slowfd < 0 ? -1 : msnow();
+}
+
+/* n has finished; log it if it took too long */
+
+extern void slowend(long start, Node *n) {
+	long ms;
+	char *entry;
+
+	if (start < 0 || (ms = msnow() - start) < slowms)
+		return;
+	if (slowstale)
+		slowinit();
+	if (slowfd < 0)
+		return;
+	entry = nprint("%ld %ldms status %L pid %d line %d: %T\n",
+		(long) time(NULL), ms, sgetstatus(), "|", getpid(),
+		lineno - (lastchar == '\n'), n);
+	writeall(slowfd, entry, strlen(entry));
+}
@@ -72,7 +72,7 @@ extern Node *mk(enum nodetype t,...) {
 		n = nalloc(offsetof(Node, u[1]));
 		n->u[0].p = va_arg(ap, Node *);
 		break;
-	case nAndalso: case nAssign: case nBackq: case nBody: case nBrace: case nConcat:
+	case nAndalso: case nAssign: case nBackq: case nFuture: case nBody: case nBrace: case nConcat:
 	case nElse: case nEpilog: case nIf: case nNewfn: case nCbody:
 	case nOrelse: case nPre: case nArgs: case nSwitch:
 	case nMatch: case nVarsub: case nWhile: case nLappend:
@@ -144,7 +144,7 @@ extern Node *treecpy(Node *s, void *(*alloc)(size_t)) {
 		n = (*alloc)(offsetof(Node, u[1]));
 		n->u[0].p = treecpy(s->u[0].p, alloc);
 		break;
-	case nAndalso: case nAssign: case nBackq: case nBody: case nBrace: case nConcat:
+	case nAndalso: case nAssign: case nBackq: case nFuture: case nBody: case nBrace: case nConcat:
 	case nElse: case nEpilog: case nIf: case nNewfn: case nCbody:
 	case nOrelse: case nPre: case nArgs: case nSwitch:
 	case nMatch: case nVarsub: case nWhile: case nLappend:
@@ -197,7 +197,7 @@ extern void treefree(Node *s) {
 	case nSubshell: case nVar: case nCase:
 		treefree(s->u[0].p);
 		break;
-	case nAndalso: case nAssign: case nBackq: case nBody: case nBrace: case nConcat:
+	case nAndalso: case nAssign: case nBackq: case nFuture: case nBody: case nBrace: case nConcat:
 	case nElse: case nEpilog: case nIf: case nNewfn:
 	case nOrelse: case nPre: case nArgs: case nCbody:
 	case nSwitch: case nMatch:  case nVarsub: case nWhile:
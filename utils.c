@@ -56,6 +56,31 @@ extern int n2u(char *s, unsigned int base) {
 	return (int) i;
 }
 
+/*
+   Decimal words for small numbers, such as $#x and $status, are made
+   once and kept in a table, so that they need not be formatted and
+   allocated each time. The words must not be modified.
+*/
+
+#define NUMWORDS 1024
+
+static char numwords[NUMWORDS][5];
+
+extern char *numword(int n) {
+	char *w;
+	int i;
+	if (n < 0 || n >= NUMWORDS)
+		return nprint("%d", n);
+	w = numwords[n];
+	if (*w == '\0') {
+		i = (n >= 1000) + (n >= 100) + (n >= 10);
+		w[i + 1] = '\0';
+		for (; i >= 0; i--, n /= 10)
+			w[i] = '0' + n % 10;
+	}
+	return w;
+}
+
 /* The last word in portable ANSI: a strcmp wrapper for qsort */
 
 extern int starstrcmp(const void *s1, const void *s2) {
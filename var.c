@@ -3,34 +3,51 @@
 #include "rc.h"
 
 #include "input.h"
+#include "interp.h"
 
 static void colonassign(char *, List *, bool);
 static void listassign(char *, List *, bool);
 static int hasalias(char *);
+static void varchanged(char *);
 
 static char *const aliases[] = {
 	"home", "HOME", "path", "PATH", "cdpath", "CDPATH"
 };
 
+static bool aliasset[arraysize(aliases)];	/* seen in the environment */
+
+const Region varglobals[] = {
+	REGION(aliasset),
+	{ NULL, 0 }
+};
+
 /* assign a variable in List form to a name, stacking if appropriate */
 
 extern void varassign(char *name, List *def, bool stack) {
 	Variable *new;
-	List *newdef = listcpy(def, ealloc); /* important to do the listcpy first; get_var_place() frees old values */
+	Value *newval = listval(def); /* important to do the listval first; get_var_place() frees old values */
 	new = get_var_place(name, stack);
-	new->def = newdef;
+	new->val = newval;
 	new->extdef = NULL;
 	set_exportable(name, TRUE);
+	if (!stack)
+		dropfuture(name);
+	varchanged(name);
+}
+
+/* tell anyone who caches a variable that it has a new value */
+
+static void varchanged(char *name) {
 	if (streq(name, "TERM") || streq(name, "TERMCAP"))
 		termchange();
+	else if (streq(name, "xtrace") || streq(name, "xtraceopts")
+	    || streq(name, "slowlog") || streq(name, "slowms"))
+		tracechange();
 }
 
 /* assign a variable in string form. Check to see if it is aliased (e.g., PATH and path) */
 
 extern bool varassign_string(char *extdef) {
-	static bool aliasset[arraysize(aliases)] = {
-		FALSE, FALSE, FALSE, FALSE, FALSE, FALSE
-	};
 	char *name = get_name(extdef);
 	Variable *new;
 	int i;
@@ -43,7 +60,7 @@ extern bool varassign_string(char *extdef) {
 			return TRUE;
 	}
 	new = get_var_place(name, FALSE);
-	new->def = NULL;
+	new->val = NULL;
 	new->extdef = ealloc(strlen(extdef) + 1);
 	strcpy(new->extdef, extdef);
 	if (i != -1)
@@ -67,6 +84,8 @@ extern List *varlookup(char *name) {
 		return sgetapids();
 	if (streq(name, "status"))
 		return sgetstatus();
+	if (streq(name, "rcstats"))
+		return sgetstats();
 	if (*name != '\0' && (sub = a2u(name)) != -1) { /* handle $1, $2, etc. */
 		for (l = varlookup("*"); l != NULL && sub != 0; --sub)
 			l = l->n;
@@ -78,11 +97,12 @@ extern List *varlookup(char *name) {
 		ret->n = NULL;
 		return ret;
 	}
+	await(name);
 	look = lookup_var(name);
 	if (look == NULL)
 		return NULL; /* not found */
-	if (look->def != NULL)
-		return look->def;
+	if (look->val != NULL)
+		return look->val->def;
 	if (look->extdef == NULL)
 		return NULL; /* variable was set to null, e.g., a=() echo foo */
 	ret = parse_var(look->extdef);
@@ -90,7 +110,20 @@ extern List *varlookup(char *name) {
 		look->extdef = NULL;
 		return NULL;
 	}
-	return look->def = ret;
+	look->val = listown(ret);
+	return ret;
+}
+
+/* Return the number of elements in a variable, without walking its list if it is stored. */
+
+extern int varnel(char *name) {
+	Variable *look;
+	if (streq(name, "apids") || streq(name, "status") || streq(name, "rcstats") || (*name != '\0' && a2u(name) != -1))
+		return listnel(varlookup(name));
+	if (varlookup(name) == NULL)
+		return 0;
+	look = lookup_var(name);
+	return look->val->nel;
 }
 
 /* lookup a variable in external (string) form, converting if necessary. Used by makeenv() */
@@ -102,9 +135,9 @@ extern char *varlookup_string(char *name) {
 		return NULL;
 	if (look->extdef != NULL)
 		return look->extdef;
-	if (look->def == NULL)
+	if (look->val == NULL)
 		return NULL;
-	return look->extdef = mprint("%F=%W", name, look->def);
+	return look->extdef = unparse_var(name, look->val->def);
 }
 
 /* remove a variable from the symtab. "stack" determines whether a level of scoping is popped or not */
@@ -118,6 +151,11 @@ extern void varrm(char *name, bool stack) {
 	delete_var(name, stack);
 	if (i != -1)
 		delete_var(aliases[i^1], stack);
+	if (!stack)
+		dropfuture(name);
+	if (streq(name, "xtrace") || streq(name, "xtraceopts")
+	    || streq(name, "slowlog") || streq(name, "slowms"))
+		tracechange();
 }
 
 /* assign a value (List) to a variable, using array "a" as input. Used to assign $* */
@@ -143,6 +181,125 @@ extern void starassign(char *dollarzero, char **a, bool stack) {
 	varassign("*", var, stack);
 }
 
+/*
+   Shift $* n places. The value of $* is treated as a view: the cells
+   being shifted off are unlinked from behind $0, and freed if they
+   belong to this value. If the value is shared, $* first gets a value
+   of its own consisting of a fresh $0 in front of the shared cells, so
+   the rest of the list is never copied. Returns FALSE, leaving $*
+   alone, if there are fewer than n arguments.
+*/
+
+extern bool starshift(int n) {
+	Variable *star;
+	Value *v;
+	List *zero;
+	if (varlookup("*") == NULL) /* converts an extdef, if need be */
+		return n == 0;
+	star = lookup_var("*");
+	v = star->val;
+	if (n > v->nel - 1)
+		return FALSE;
+	if (n == 0)
+		return TRUE;
+	if (v->refs > 1) { /* copy on write, keeping our reference as the share */
+		List *oldzero = v->def;
+		Value *w = listval(word(oldzero->w, NULL));
+		w->def->n = oldzero->n;
+		w->nel = v->nel;
+		w->share = v;
+		star->val = v = w;
+	}
+	zero = v->def;
+	while (n-- > 0) {
+		List *dead = zero->n;
+		zero->n = dead->n;
+		v->nel--;
+		if (v->own > 1) {
+			v->own--;
+			efree(dead->w);
+			efree(dead);
+		}
+	}
+	v->last = NULL;
+	efree(star->extdef);
+	star->extdef = NULL;
+	set_env_dirty();
+	return TRUE;
+}
+
+/*
+   x = ($x ...) and x = $x^... grow the value of x in place, rather
+   than copying it, when that value is old (the list glommed from $x)
+   and nobody else holds it. Cells are added at the end of the list,
+   which is found once and then remembered, and a one-word value is
+   grown by doubling its size, so that building up a variable a piece
+   at a time takes linear time. These return FALSE if the value must
+   be copied after all; see selfassign().
+*/
+
+static Variable *growable(char *name, List *old) {
+	Variable *look;
+	if (old == NULL || hasalias(name) != -1 || varlookup(name) != old)
+		return NULL;
+	look = lookup_var(name);
+	if (look->val->refs > 1 || look->val->share != NULL)
+		return NULL;
+	return look;
+}
+
+static void grown(Variable *look, char *name) {
+	efree(look->extdef);
+	look->extdef = NULL;
+	set_env_dirty();
+	set_exportable(name, TRUE);
+	dropfuture(name);
+	varchanged(name);
+}
+
+extern bool varappend(char *name, List *old, List *s) {
+	Variable *look;
+	Value *v;
+	List *top, *end;
+	int n;
+	if (s == NULL || (look = growable(name, old)) == NULL)
+		return FALSE;
+	v = look->val;
+	top = listcpy(s, ealloc); /* first, since s may be old itself */
+	for (n = 1, end = top; end->n != NULL; end = end->n)
+		n++;
+	if (v->last == NULL)
+		for (v->last = v->def; v->last->n != NULL; v->last = v->last->n)
+			;
+	v->last->n = top;
+	v->last = end;
+	v->nel += n;
+	v->own += n;
+	v->len = v->cap = 0;
+	grown(look, name);
+	return TRUE;
+}
+
+extern bool varconcat(char *name, List *old, char *w) {
+	Variable *look;
+	Value *v;
+	size_t n = strlen(w);
+	if ((look = growable(name, old)) == NULL || old->n != NULL)
+		return FALSE;
+	v = look->val;
+	if (v->cap == 0)
+		v->cap = (v->len = strlen(old->w)) + 1;
+	if (v->len + n + 1 > v->cap) {
+		while (v->len + n + 1 > v->cap)
+			v->cap *= 2;
+		old->w = erealloc(old->w, v->cap);
+	}
+	memcpy(old->w + v->len, w, n + 1);
+	v->len += n;
+	grown(look, name);
+	return TRUE;
+}
+
 /* (ugly name, huh?) assign a colon-separated value to a variable (e.g., PATH) from a List (e.g., path) */
 
 static void colonassign(char *name, List *def, bool stack) {
@@ -205,26 +362,32 @@ extern void alias(char *name, List *s, bool stack) {
 	}
 }
 
-extern void prettyprint_var(int fd, char *name, List *s) {
+/* a variable assignment in rc syntax, or NULL if there is nothing to show */
+
+extern char *prettyvar(char *name, List *s) {
 	int i;
 	static const char * const keywords[] = {
 		"if", "in", "fn", "for", "else", "switch", "while", "case"
 	};
-	if (s == NULL) {
-		fprint(fd, "%S=()\n", name);
-		return;
-	}
+	char *eq;
+	if (s == NULL)
+		return nprint("%S=()", name);
 	if (streq(name, "*")) {
 		s = s->n;
 		if (s == NULL)
-			return; /* Don't print $0, and if $* is not set, skip it */
+			return NULL; /* Don't print $0, and if $* is not set, skip it */
 	}
+	eq = "%S=";
 	for (i = 0; i < arraysize(keywords); i++)
 		if (streq(keywords[i], name)) {
-			fprint(fd, "%#S=", name);
-			goto value;
+			eq = "%#S=";
+			break;
 		}
-	fprint(fd, "%S=", name);
-value:
-	fprint(fd, s->n == NULL ? "%L\n" : "(%L)\n", s, " ");
+	return nprint(s->n == NULL ? "%s%L" : "%s(%L)", nprint(eq, name), s, " ");
+}
+
+extern void prettyprint_var(int fd, char *name, List *s) {
+	char *p = prettyvar(name, s);
+	if (p != NULL)
+		fprint(fd, "%s\n", p);
 }
@@ -1,7 +1,18 @@
+#include "config.h"
+#if HAVE_PPOLL
+#define _GNU_SOURCE /* for ppoll() */
+#endif
+
 #include "rc.h"
 
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
+#if HAVE_PIDFD_OPEN
+#include <sys/syscall.h>
+#endif
 
+#include "probe.h"
 #include "wait.h"
 
 bool forked = FALSE;
@@ -12,21 +23,33 @@ static struct Pid {
 	pid_t pid;
 	int stat;
 	bool alive;
+	bool own;	/* rc's own child, which wait and $apids leave alone */
+	int token;	/* make job slot, or -1 */
 	Pid *n;
 } *plist = NULL;
 
+static int nexttoken = -1;	/* for the next rc_fork() */
+static unsigned long forks;
+
 extern pid_t rc_fork() {
 	Pid *new;
 	struct Pid *p, *q;
-	pid_t pid = fork();
+	pid_t pid;
+
+	traceflush(); /* or the child would write it too */
+	pid = fork();
 
 	switch (pid) {
 	case -1:
+		jobgive(nexttoken);
+		nexttoken = -1;
 		uerror("fork");
 		rc_error(NULL);
 		/* NOTREACHED */
 	case 0:
 		forked = TRUE;
+		nexttoken = -1; /* the parent hands it back */
+		forkredirs(TRUE);
 		sigchk();
 		p = plist; q = 0;
 		while (p) {
@@ -38,21 +61,100 @@ extern pid_t rc_fork() {
 		plist = 0;
 		return 0;
 	default:
+		forks++;
+		forkredirs(FALSE);
 		new = enew(Pid);
 		new->pid = pid;
 		new->alive = TRUE;
+		new->own = FALSE;
+		new->token = nexttoken;
+		nexttoken = -1;
+		RC_PROBE1(fork, pid);
 		new->n = plist;
 		plist = new;
 		return pid;
 	}
 }
 
+static Pid *child(pid_t pid) {
+	Pid *p;
+	for (p = plist; p != NULL; p = p->n)
+		if (p->pid == pid)
+			break;
+	return p;
+}
+
+/*
+   A child which rc forked for its own use, and will wait for by pid,
+   is kept from wait and $apids; own is FALSE to give one back.
+*/
+
+extern void ownchild(pid_t pid, bool own) {
+	Pid *p = child(pid);
+	if (p != NULL)
+		p->own = own;
+}
+
+/* are there any children for wait to wait for? */
+
+static bool waitable() {
+	Pid *p;
+	for (p = plist; p != NULL; p = p->n)
+		if (!p->own)
+			return TRUE;
+	return FALSE;
+}
+
+/*
+   Fork a child which runs alongside rc, first taking a make job slot
+   for it if there is a jobserver. While it waits for a slot, rc reaps
+   any of its children that hold one, since nothing else would.
+*/
+
+extern pid_t rc_forkjob() {
+	int c, fd, n, r, stat;
+	bool out = FALSE, *ready;
+	pid_t *pids;
+	Pid *p;
+
+	while ((c = jobtake()) < 0 && errno != 0) {
+		if (errno == EINTR) {
+			sigchk();
+			continue;
+		}
+		for (n = 0, p = plist; p != NULL; p = p->n)
+			if (p->token >= 0)
+				n++;
+		pids = ealloc((n + 1) * sizeof *pids);
+		ready = ealloc((n + 1) * sizeof *ready);
+		for (n = 0, p = plist; p != NULL; p = p->n)
+			if (p->token >= 0)
+				pids[n++] = p->pid;
+		fd = jobpipe();
+		r = rc_poll(&fd, &out, 1, pids, n, -1, ready);
+		for (; r > 0 && n > 0; n--)
+			if (ready[n] && (p = child(pids[n - 1])) != NULL
+			    && waitpid(p->pid, &stat, 0) == p->pid) {
+				p->alive = FALSE;
+				p->stat = stat;
+				jobgive(p->token);
+				p->token = -1;
+			}
+		efree(pids);
+		efree(ready);
+		if (r < 0 && errno == EINTR)
+			sigchk();
+	}
+	nexttoken = c;
+	return rc_fork();
+}
+
 extern pid_t rc_wait4(pid_t pid, int *stat, bool nointr) {
 	Pid **p, *r;
 
 	/* Find the child on the list. */
 	for (p = &plist; *p; p = &(*p)->n)
-		if ((*p)->pid == pid || (pid == -1 && !(*p)->alive))
+		if ((*p)->pid == pid || (pid == -1 && !(*p)->alive && !(*p)->own))
 			break;
 
 	/* Uh-oh, not there. */
@@ -81,10 +183,12 @@ extern pid_t rc_wait4(pid_t pid, int *stat, bool nointr) {
 
 		for (q = &plist; *q; q = &(*q)->n)
 			if ((*q)->pid == ret) {
-				if (pid == -1)
+				if (pid == -1 && !(*q)->own)
 					p = q;
 				(*q)->alive = FALSE;
 				(*q)->stat = *stat;
+				jobgive((*q)->token);
+				(*q)->token = -1;
 				break;
 			}
 	}
@@ -93,15 +197,35 @@ extern pid_t rc_wait4(pid_t pid, int *stat, bool nointr) {
 	*stat = r->stat;
 	*p = r->n; /* remove element from list */
 	efree(r);
+	RC_PROBE2(wait, pid, *stat);
 	return pid;
 }
 
+/*
+   rc is about to exit or exec: hand back the make job slots its
+   unreaped children hold, since nothing else will.
+*/
+
+extern void giveslots() {
+	Pid *p;
+	for (p = plist; p != NULL; p = p->n) {
+		jobgive(p->token);
+		p->token = -1;
+	}
+}
+
+/* for $rcstats */
+
+extern void forkstats(unsigned long *n) {
+	*n = forks;
+}
+
 extern List *sgetapids() {
 	List *r;
 	Pid *p;
 	for (r = NULL, p = plist; p != NULL; p = p->n) {
 		List *q;
-		if (!p->alive)
+		if (!p->alive || p->own)
 			continue;
 		q = nnew(List);
 		q->w = nprint("%d", p->pid);
@@ -115,7 +239,7 @@ extern List *sgetapids() {
 extern void waitforall() {
 	int stat;
 
-	while (plist != NULL) {
+	while (waitable()) {
 		pid_t pid = rc_wait4(-1, &stat, FALSE);
 		if (pid > 0)
 			setstatus(pid, stat);
@@ -127,3 +251,110 @@ extern void waitforall() {
 		sigchk();
 	}
 }
+
+/* has a child exited? it is not reaped, so that wait can still collect it */
+
+static bool exited(Pid *p) {
+	siginfo_t info;
+	if (!p->alive)
+		return TRUE;
+	info.si_pid = 0;
+	return waitid(P_PID, p->pid, &info, WEXITED|WNOHANG|WNOWAIT) == 0 && info.si_pid == p->pid;
+}
+
+static long now() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000L + t.tv_nsec / 1000000;
+}
+
+/*
+   Block until one of fds is ready for reading (or for writing, where
+   out[i] is set), until one of pids exits, or for ms milliseconds
+   (forever if ms < 0). Sets ready[] for the fds and then the pids, and
+   returns how many are ready, or -1 on an error (EINTR for a signal,
+   which the caller should check for with sigchk()). Children are watched
+   through a pidfd where the system has them; otherwise rc looks at
+   them every 50ms, and only its own children can be watched.
+*/
+
+extern int rc_poll(int *fds, bool *out, int nfds, pid_t *pids, int npids, long ms, bool *ready) {
+	struct pollfd *pfd = ealloc((nfds + npids + 1) * sizeof *pfd);
+	bool scan = FALSE;
+	Pid *p;
+	long end = ms < 0 ? 0 : now() + ms, slice;
+	int i, r, n = 0;
+
+	for (i = 0; i < nfds; i++) {
+		pfd[i].fd = fds[i];
+		pfd[i].events = out[i] ? POLLOUT : POLLIN;
+		ready[i] = FALSE;
+	}
+	for (i = 0; i < npids; i++) {
+		pfd[nfds + i].fd = -1; /* ignored by poll() */
+		pfd[nfds + i].events = POLLIN;
+		pfd[nfds + i].revents = 0;
+	}
+	for (i = 0; i < npids; i++) {
+		if ((p = child(pids[i])) != NULL && exited(p)) {
+			ready[nfds + i] = TRUE;
+			n++;
+			continue;
+		}
+		ready[nfds + i] = FALSE;
+#if HAVE_PIDFD_OPEN && defined(SYS_pidfd_open)
+		if ((pfd[nfds + i].fd = syscall(SYS_pidfd_open, pids[i], 0)) >= 0)
+			continue;
+		if (errno == ESRCH) { /* gone already */
+			ready[nfds + i] = TRUE;
+			n++;
+			continue;
+		}
+#endif
+		if (p == NULL) { /* another process's child, which only a pidfd can watch */
+			errno = ECHILD;
+			n = -1;
+			goto done;
+		}
+		scan = TRUE;
+	}
+	if (n > 0)
+		end = ms = 0;
+	for (;;) {
+		slice = ms < 0 ? -1 : end - now();
+		if (slice < 0 && ms >= 0)
+			slice = 0;
+		if (scan && (slice < 0 || slice > 50))
+			slice = 50;
+#if HAVE_PPOLL
+		{
+			struct timespec t;
+			t.tv_sec = slice / 1000;
+			t.tv_nsec = slice % 1000 * 1000000;
+			r = ppoll(pfd, nfds + npids, slice < 0 ? NULL : &t, NULL);
+		}
+#else
+		r = poll(pfd, nfds + npids, slice);
+#endif
+		if (r < 0) {
+			n = -1;
+			break;
+		}
+		for (i = 0; i < nfds + npids; i++)
+			if (!ready[i] && (i < nfds ? pfd[i].revents != 0 :
+			    pfd[i].fd >= 0 ? (pfd[i].revents & POLLIN) != 0 : exited(child(pids[i - nfds])))) {
+				ready[i] = TRUE;
+				n++;
+			}
+		if (n > 0 || (ms >= 0 && now() >= end))
+			break;
+	}
+done:
+	r = errno;
+	for (i = nfds; i < nfds + npids; i++)
+		if (pfd[i].fd >= 0)
+			close(pfd[i].fd);
+	efree(pfd);
+	errno = r;
+	return n;
+}
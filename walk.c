@@ -1,6 +1,7 @@
 /* walk.c: walks the parse tree. */
 
 #include "rc.h"
+#include "interp.h"
 #include "wait.h"
 
 #include <signal.h>
@@ -25,6 +26,11 @@ static void loop_body(Node* n);
 enum if_state { if_false, if_true, if_nothing };
 enum if_state if_last = if_nothing;
 
+const Region walkglobals[] = {
+	REGION(cond), REGION(if_last),
+	{ NULL, 0 }
+};
+
 /* Tail-recursive version of walk() */
 
 #define WALK(x, y) { n = x; parent = y; goto top; }
@@ -35,23 +41,26 @@ extern bool walk(Node *n, bool parent) {
 top:	sigchk();
 	if (n == NULL) {
 		if (!parent)
-			exit(0);
+			childexit(0);
 		set(TRUE);
 		return TRUE;
 	}
 	switch (n->type) {
-	case nArgs: case nBackq: case nConcat: case nCount:
+	case nArgs: case nBackq: case nFuture: case nConcat: case nCount:
 	case nFlat: case nLappend: case nRedir: case nVar:
-	case nVarsub: case nWord:
+	case nVarsub: case nWord: {
+		long t = slowstart();
 		exec(glob(glom(n)), parent);	/* simple command */
+		slowend(t, n);
 		break;
+	}
 	case nBody:
 		walk(n->u[0].p, TRUE);
 		WALK(n->u[1].p, parent);
 		/* WALK doesn't fall through */
 	case nNowait: {
 		int pid;
-		if ((pid = rc_fork()) == 0) {
+		if ((pid = rc_forkjob()) == 0) {
 #if defined(RC_JOB) && defined(SIGTTOU) && defined(SIGTTIN) && defined(SIGTSTP)
 			setsigdefaults(FALSE);
 			rc_signal(SIGTTOU, SIG_IGN);	/* Berkeleyized version: put it in a new pgroup. */
@@ -63,7 +72,7 @@ top:	sigchk();
 #endif
 			mvfd(rc_open("/dev/null", rFrom), 0);
 			walk(n->u[0].p, FALSE);
-			exit(getstatus());
+			childexit(getstatus());
 		}
 		if (interactive)
 			fprint(2, "%d\n", pid);
@@ -153,23 +162,28 @@ top:	sigchk();
 	case nForin: {
 		List *l, *var = glom(n->u[0].p);
 		Jbwrap break_jb;
-		Edata  break_data;
-		Estack break_stack;
-		if (sigsetjmp(break_jb.j, 1))
-			break;
-		break_data.jb = &break_jb;
-		except(eBreak, break_data, &break_stack);
+		Edata  break_data, list_data;
+		Estack break_stack, list_stack;
 
-		for (l = listcpy(glob(glom(n->u[1].p)), nalloc); l != NULL; l = l->n) {
-			Edata  iter_data;
-			Estack iter_stack;
-			assign(var, word(l->w, NULL), FALSE);
-			iter_data.b = newblock();
-			except(eArena, iter_data, &iter_stack);
-			loop_body(n->u[2].p);
-			unexcept(eArena);
+		/* hold a reference, so the body may reassign the variable being iterated */
+		list_data.val = listval(glob(glom(n->u[1].p)));
+		except(eValue, list_data, &list_stack);
+		if (sigsetjmp(break_jb.j, 1) == 0) {
+			break_data.jb = &break_jb;
+			except(eBreak, break_data, &break_stack);
+
+			for (l = list_data.val == NULL ? NULL : list_data.val->def; l != NULL; l = l->n) {
+				Edata  iter_data;
+				Estack iter_stack;
+				assign(var, word(l->w, NULL), FALSE);
+				iter_data.b = newblock();
+				except(eArena, iter_data, &iter_stack);
+				loop_body(n->u[2].p);
+				unexcept(eArena);
+			}
+			unexcept(eBreak);
 		}
-		unexcept(eBreak);
+		unexcept(eValue);
 		break;
 	}
 	case nSubshell:
@@ -182,19 +196,25 @@ top:	sigchk();
 	case nAssign:
 		if (n->u[0].p == NULL)
 			rc_error("null variable name");
-		assign(glom(n->u[0].p), glob(glom(n->u[1].p)), FALSE);
+		if (n->u[1].p != NULL && n->u[1].p->type == nFuture)
+			future(glom(n->u[0].p), n->u[1].p);
+		else if (!selfassign(n->u[0].p, n->u[1].p))
+			assign(glom(n->u[0].p), glob(glom(n->u[1].p)), FALSE);
 		set(TRUE);
 		break;
-	case nPipe:
+	case nPipe: {
+		long t = slowstart();
 		dopipe(n);
+		slowend(t, n);
 		break;
+	}
 	case nNewfn: {
 		List *l = glom(n->u[0].p);
 		if (l == NULL)
 			rc_error("null function name");
 		while (l != NULL) {
 			if (dashex)
-				prettyprint_fn(2, l->w, n->u[1].p);
+				tracefn(l->w, n->u[1].p);
 			fnassign(l->w, n->u[1].p);
 			l = l->n;
 		}
@@ -205,7 +225,7 @@ top:	sigchk();
 		List *l = glom(n->u[0].p);
 		while (l != NULL) {
 			if (dashex)
-				fprint(2, "fn %S\n", l->w);
+				tracefn(l->w, NULL);
 			fnrm(l->w);
 			l = l->n;
 		}
@@ -218,7 +238,7 @@ top:	sigchk();
 	case nMatch: {
 		List *a = glob(glom(n->u[0].p)), *b = glom(n->u[1].p);
 		if (dashex)
-			fprint(2, (a != NULL && a->n != NULL) ? "~ (%L) %L\n" : "~ %L %L\n", a, " ", b, " ");
+			tracematch(a, b);
 		set(lmatch(a, b));
 		break;
 	}
@@ -246,7 +266,7 @@ top:	sigchk();
 			setsigdefaults(FALSE);
 			qredir(n->u[0].p);
 			if (!haspreredir(n->u[1].p))
-				doredirs(); /* no more preredirs, empty queue */
+				doredirs(FALSE); /* no more preredirs, empty queue */
 			walk(n->u[1].p, FALSE);
 			rc_exit(getstatus());
 			/* NOTREACHED */
@@ -286,7 +306,7 @@ top:	sigchk();
 		if (n->u[1].p != NULL) {
 			WALK(n->u[1].p, parent); /* Do more redirections. */
 		} else {
-			doredirs();	/* Okay, we hit the bottom. */
+			doredirs(FALSE);	/* Okay, we hit the bottom. */
 		}
 		break;
 	case nNmpipe:
@@ -340,6 +360,96 @@ static bool dofork(bool parent) {
 	return FALSE;
 }
 
+/* can the words of a simple command be evaluated without redirections? */
+
+static bool plainargs(Node *n) {
+	if (n == NULL)
+		return TRUE;
+	switch (n->type) {
+	default:
+		return FALSE;
+	case nArgs: case nLappend: case nConcat:
+		return plainargs(n->u[0].p) && plainargs(n->u[1].p);
+	case nVarsub:
+		return plainargs(n->u[1].p);
+	case nWord: case nVar: case nFlat: case nCount: case nBackq:
+		return TRUE;
+	}
+}
+
+/*
+   The first stage of a pipeline such as "echo $list | sort" is run by
+   rc itself, writing straight into the pipe, if it is a builtin which
+   only writes. An error in it ends just that stage, as it would in a
+   child. Signals are held off while the builtin writes, so a broken
+   pipe is reported as the stage dying of sigpipe; they are not held
+   while its words are evaluated, since a backquote there forks, and
+   its child must not inherit the mask. Returns FALSE if the stage must
+   be forked after all.
+
+   Every other stage, and a head that is a function or any other
+   builtin, is still forked: running one in the shell would need its
+   reads from the pipe to give way to the stages writing it, and rc's
+   builtins and functions read with plain blocking calls and share the
+   shell's variables.
+*/
+
+static bool instage(Node *n, int fd, int out, int *stat) {
+	Node *w;
+	Jbwrap j;
+	Estack e;
+	Edata jerror;
+	sigset_t all, old, pending;
+	void (*h)(int);
+	builtin_t *b;
+	bool i = interactive, oldcond = cond;
+	List *args;
+	int saved;
+
+	if (forked) /* where an error would end the process */
+		return FALSE;
+	for (w = n; w != NULL && (w->type == nArgs || w->type == nLappend); w = w->u[0].p)
+		;
+	if (w == NULL || w->type != nWord || !plainargs(n) || fnlookup(w->u[0].s) != NULL
+	    || (b = isbuiltin(w->u[0].s)) == NULL || !writeonly(b))
+		return FALSE;
+	if ((saved = dup(out)) < 0)
+		return FALSE;
+	if (dup2(fd, out) < 0) {
+		close(saved);
+		return FALSE;
+	}
+	sigfillset(&all);
+	sigprocmask(SIG_SETMASK, NULL, &old);
+	redirq = NULL;
+	cond = TRUE; /* a false stage does not end rc -e */
+	if (sigsetjmp(j.j, 1) == 0) {
+		jerror.jb = &j;
+		except(eError, jerror, &e);
+		e.interactive = TRUE; /* so that rc_raise() stops here */
+		args = glob(glom(n));
+		sigprocmask(SIG_BLOCK, &all, NULL);
+		exec(args, TRUE);
+		unexcept(eError);
+	}
+	interactive = i;
+	cond = oldcond;
+	redirq = NULL;
+	*stat = getrawstatus();
+	dup2(saved, out);
+	close(saved);
+	if (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) && !sigismember(&old, SIGPIPE)) {
+		*stat = SIGPIPE;
+		h = sys_signal(SIGPIPE, SIG_IGN); /* discard it */
+		sigemptyset(&all);
+		sigaddset(&all, SIGPIPE);
+		sigprocmask(SIG_UNBLOCK, &all, NULL);
+		sys_signal(SIGPIPE, h);
+	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	return TRUE;
+}
+
 static void dopipe(Node *n) {
 	int i, j, sp, pid, fd_prev, fd_out, pids[512], stats[512], p[2];
 	bool intr;
@@ -364,7 +474,7 @@ static void dopipe(Node *n) {
 				mvfd(fd_prev, fd_out);
 			close(p[1]);
 			walk(r->u[3].p, FALSE);
-			exit(getstatus());
+			childexit(getstatus());
 		}
 		if (fd_prev != 1)
 			close(fd_prev); /* parent must close all pipe fd's */
@@ -373,11 +483,13 @@ static void dopipe(Node *n) {
 		fd_out = r->u[0].i;
 		close(p[0]);
 	}
-	if ((pid = rc_fork()) == 0) {
+	if (instage(r, fd_prev, fd_out, &stats[i])) {
+		pid = -1;
+	} else if ((pid = rc_fork()) == 0) {
 		setsigdefaults(FALSE);
 		mvfd(fd_prev, fd_out);
 		walk(r, FALSE);
-		exit(getstatus());
+		childexit(getstatus());
 		/* NOTREACHED */
 	}
 	redirq = NULL; /* clear preredir queue */
@@ -388,6 +500,8 @@ static void dopipe(Node *n) {
 
 	intr = FALSE;
 	for (j = 0; j < i; j++) {
+		if (pids[j] == -1)
+			continue; /* run by rc itself */
 		rc_wait4(pids[j], &sp, TRUE);
 		stats[j] = sp;
 		intr |= WIFSIGNALED(sp);